@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+#####################################################################
+#
+# This file is licensed under the University of Illinois/NCSA Open
+# Source License. See LICENSE.TXT for details.
+#
+#####################################################################
+
+#####################################################################
+#
+# Name: bench.py
+#
+# Description: End-to-end benchmark of FlipIt on the proxy kernels.
+#       For every kernel it reports the build time natively and
+#       through flipit-cc, the number of fault sites and def-use
+#       classes, the kernel time natively and instrumented with
+#       the null, profiling, and full runtimes (as slowdowns), and
+#       for every rank count the trials per hour of a short
+#       campaign in every campaign mode. Results go to results.csv.
+#
+#       Usage: python3 bench.py [bench_config.py directory]
+#
+#####################################################################
+import glob
+import os
+import re
+import shutil
+import sqlite3
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FLIPIT = os.path.abspath(os.path.join(HERE, "..", ".."))
+sys.path.insert(0, os.path.join(FLIPIT, "scripts", "analysis"))
+from binaryParser import parseBinaryLogFile
+
+# bench_config.py in the given (or current) directory wins over the default one
+sys.path.insert(0, os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else os.getcwd()))
+from bench_config import *
+
+VARIANTS = ("null", "profile", "full")
+proxyLine = re.compile(r"^PROXY (\S+) .*time=(\S+) result=(\S+)", re.M)
+
+
+def make(*targets):
+    """Runs make in this directory and returns the seconds it took"""
+    start = time.time()
+    ret = subprocess.call(["make", "-C", HERE] + list(targets), stdout=subprocess.DEVNULL)
+    if ret != 0:
+        raise RuntimeError("make %s failed" % " ".join(targets))
+    return time.time() - start
+
+
+def build(kernel):
+    """Build seconds of the native and the instrumented kernel: compiling
+    the kernel and linking it, not the runtime or the driver, which every
+    kernel shares"""
+    make("runtime" if not native_only else "lib/libcorrupt.a", "main.o")
+    seconds = []
+    for b in ("native", "flipit")[0:1 if native_only else 2]:
+        for name in ("%s-%s.o" % (kernel, b), "%s-%s" % (kernel, b)):
+            if os.path.exists(os.path.join(HERE, name)):
+                os.remove(os.path.join(HERE, name))
+        seconds.append(make("%s-%s" % (kernel, b)))
+    return seconds[0], seconds[1] if len(seconds) > 1 else None
+
+
+def sites(kernel):
+    """Fault sites and def-use classes in the kernel's LLVM log file"""
+    conn = sqlite3.connect(":memory:")
+    c = conn.cursor()
+    c.execute("CREATE TABLE sites (site int, type text, comment text, file text, function text, line int, opcode text, class int, classSize int, weight double)")
+    parseBinaryLogFile(c, os.path.join(HERE, kernel + ".c.LLVM.bin"))
+    return c.execute("SELECT COUNT(*), COUNT(DISTINCT class) FROM sites").fetchone()
+
+
+def command(kernel, build, nranks, variant=None):
+    """Command line of one run; the shared runtime variant is set for every
+    rank through env so it does not depend on what mpirun forwards"""
+    cmd = mpirun.format(ranks=nranks) + " "
+    if variant is not None:
+        cmd += "env LD_LIBRARY_PATH=%s " % os.path.join(HERE, "lib", variant)
+    cmd += os.path.join(HERE, "%s-%s" % (kernel, build))
+    if kernel in sizes:
+        cmd += " -n %d" % sizes[kernel]
+    if kernel in iters:
+        cmd += " -it %d" % iters[kernel]
+    return cmd
+
+
+def run(cmd, cwd):
+    """Kernel time and result of one run in cwd"""
+    out = subprocess.run(cmd, shell=True, cwd=cwd, stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT, universal_newlines=True).stdout
+    m = proxyLine.search(out)
+    if m is None:
+        raise RuntimeError("no PROXY line from %s:\n%s" % (cmd, out))
+    return float(m.group(2)), m.group(3)
+
+
+def best(cmd, cwd):
+    return min(run(cmd, cwd)[0] for i in range(reps))
+
+
+def profile(kernel, nranks, work):
+    """Runs the profiling runtime in work and returns the fewest site
+    executions of any rank"""
+    for name in glob.glob(os.path.join(work, "histogram_*")):
+        os.remove(name)
+    run(command(kernel, "flipit", nranks, "profile"), work)
+    counts = []
+    for name in glob.glob(os.path.join(work, "histogram_*")):
+        n = 0
+        for line in open(name):
+            split = line.split()
+            if len(split) == 3 and split[0] == "Location":
+                n += int(split[2])
+        counts.append(n)
+    return min(counts) if counts else 0
+
+
+def campaign(kernel, nranks, mode, work, golden, executions):
+    """Runs campaign_trials trials in one mode and returns how many ran and
+    the seconds they took, campaign setup included"""
+    path = os.path.join(work, mode)
+    if os.path.isdir(path):
+        shutil.rmtree(path)
+    os.makedirs(path)
+    cmd = command(kernel, "flipit", nranks) + " {flipit} --expect " + golden
+    # instances mode injects from its plan file; the others count down to a random site
+    if mode != "instances":
+        cmd += " --countdown %d" % max(executions, 1)
+
+    with open(os.path.join(path, "campaign_config.py"), "w") as f:
+        f.write("command = %r\n" % cmd)
+        f.write("mode = %r\n" % mode)
+        f.write("LLVM_log_path = %r\n" % os.path.join(work, "sites"))
+        f.write("functions = []\n")
+        f.write("trial_path = 'trials'\ntrial_prefix = 'trial'\n")
+        # never stop early, so every mode runs the same number of trials
+        f.write("target_half_width = 0.\nconfidence = 0.95\n")
+        f.write("min_trials = 2\nbatch_size = %d\nmax_trials = %d\n" %
+                (campaign_trials, campaign_trials))
+        f.write("jobs = %d\ntimeout = %d\nseed = 533\n" % (jobs, timeout))
+        f.write("sdc_pattern = 'PROXY_SDC'\ncrash_pattern = None\n")
+        f.write("profile = %r\n" % os.path.join(work, "histogram_*"))
+        f.write("importance_alpha = 0.5\nimportance_mix = 0.1\nclass_trials = 1\n")
+        f.write("results = 'campaign_rates.csv'\nplan_file = 'campaign_plan.csv'\n")
+        f.write("instance_plan = 'campaign_plan.bin'\n")
+        f.write("journal = None\nbinary = None\ndistributed = None\ncrash_records = True\n")
+
+    start = time.time()
+    subprocess.call([sys.executable, os.path.join(FLIPIT, "scripts", "campaign", "campaign.py"),
+                     path], cwd=path, stdout=subprocess.DEVNULL)
+    seconds = time.time() - start
+    trials = len(glob.glob(os.path.join(path, "trials", "trial_*.txt")))
+    return trials, seconds
+
+
+def bench():
+    columns = ["kernel", "ranks", "build_native_s", "build_flipit_s", "sites", "classes",
+               "native_s", "null_x", "profile_x", "full_x", "executions"]
+    columns += ["%s_trials_per_hour" % m for m in modes]
+    rows = []
+    for kernel in kernels:
+        buildNative, buildFlipit = build(kernel)
+        numSites = numClasses = None
+        if not native_only:
+            numSites, numClasses = sites(kernel)
+        for nranks in ranks:
+            work = os.path.abspath(os.path.join(work_path, "%s_%d" % (kernel, nranks)))
+            if not os.path.isdir(os.path.join(work, "sites")):
+                os.makedirs(os.path.join(work, "sites"))
+            native = best(command(kernel, "native", nranks), work)
+            row = dict(kernel=kernel, ranks=nranks, build_native_s=buildNative,
+                       build_flipit_s=buildFlipit, sites=numSites, classes=numClasses,
+                       native_s=native)
+            if not native_only:
+                for v in VARIANTS:
+                    row[v + "_x"] = best(command(kernel, "flipit", nranks, v), work) / native
+                shutil.copy(os.path.join(HERE, kernel + ".c.LLVM.bin"), os.path.join(work, "sites"))
+                golden = run(command(kernel, "flipit", nranks, "null"), work)[1]
+                row["executions"] = profile(kernel, nranks, work)
+                for mode in modes:
+                    trials, seconds = campaign(kernel, nranks, mode, work, golden,
+                                               row["executions"])
+                    row["%s_trials_per_hour" % mode] = trials / seconds * 3600.
+            rows.append(row)
+            print(" ".join("%s=%s" % (c, "%.4g" % row[c] if isinstance(row[c], float)
+                                      else row[c]) for c in columns if row.get(c) is not None))
+
+    with open(results, "w") as f:
+        f.write(",".join(columns) + "\n")
+        for row in rows:
+            f.write(",".join("" if row.get(c) is None else
+                             ("%.6g" % row[c] if isinstance(row[c], float) else str(row[c]))
+                             for c in columns) + "\n")
+    print("Results written to " + results)
+
+
+if __name__ == "__main__":
+    bench()
@@ -0,0 +1,46 @@
+"""Kernels to build and benchmark: any of cg, spmv, stencil, fft, and lu.
+"""
+kernels = ["cg", "spmv", "stencil", "fft", "lu"]
+
+"""Problem size (-n) and iterations (-it) per kernel. A kernel that is not
+    listed runs with the defaults in its source file.
+
+    Notes
+    -----
+    e.g. sizes = {"cg": 512, "fft": 65536}
+"""
+sizes = {}
+iters = {}
+
+"""Number of MPI ranks to run every kernel with, and how to launch them.
+    {ranks} is replaced by the number.
+
+    Notes
+    -----
+    e.g. mpirun = "mpirun --oversubscribe -n {ranks}"
+"""
+ranks = [1, 4]
+mpirun = "mpirun -n {ranks}"
+
+"""Timed runs of every build; the fastest kernel time is reported.
+"""
+reps = 3
+
+"""Campaign modes whose throughput is measured (see ../../scripts/campaign),
+    the trials every campaign runs, the trials that run at the same time,
+    and the seconds after which a trial is killed.
+"""
+modes = ["stratified", "importance", "classes", "instances"]
+campaign_trials = 32
+jobs = 4
+timeout = 120
+
+"""Builds only the native kernels and reports their times, for machines
+    without the FlipIt pass.
+"""
+native_only = False
+
+"""Where profiles and campaigns run, and where the results go.
+"""
+work_path = "work"
+results = "results.csv"
@@ -0,0 +1,87 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: cg.c                                                                                  */
+/*                                                                                             */
+/* Description: Conjugate gradient on the 5-point Laplacian of an n x n grid with a right hand */
+/*              side of ones, for a fixed number of iterations. Rows are block distributed;    */
+/*              the search direction is gathered on every rank before each product and the    */
+/*              dot products are reduced. The result is the norm of the solution.             */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+
+const char* proxy_name = "cg";
+const int proxy_default_n = 256;
+const int proxy_default_iters = 200;
+
+static double dot(int n, const double* a, const double* b)
+{
+    double local = 0., global;
+    int i;
+    for (i = 0; i < n; i++)
+        local += a[i]*b[i];
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return global;
+}
+
+double proxy_run(ProxyArgs* args)
+{
+    int N = args->n*args->n, first, last, it, r, k, m;
+    int* counts = (int*) malloc(args->size*sizeof(int));
+    int* displs = (int*) malloc(args->size*sizeof(int));
+    double* p = (double*) malloc(N*sizeof(double));
+    double *x, *res, *Ap;
+    double rr, rrNew, alpha;
+    ProxyCSR A;
+
+    proxy_block(N, args->rank, args->size, &first, &last);
+    proxy_laplacian(args->n, first, last, &A);
+    proxy_gatherLayout(N, args->size, counts, displs);
+    m = A.rows;
+    x = (double*) calloc(m + 1, sizeof(double));
+    res = (double*) malloc((m + 1)*sizeof(double));
+    Ap = (double*) malloc((m + 1)*sizeof(double));
+
+    /* x = 0, so r = p = b = 1 */
+    for (r = 0; r < m; r++)
+        res[r] = 1.;
+    for (r = 0; r < N; r++)
+        p[r] = 1.;
+    rr = dot(m, res, res);
+
+    for (it = 0; it < args->iters && rr > 0.; it++) {
+        for (r = 0; r < m; r++) {
+            double sum = 0.;
+            for (k = A.rowStart[r]; k < A.rowStart[r + 1]; k++)
+                sum += A.val[k]*p[A.col[k]];
+            Ap[r] = sum;
+        }
+        alpha = rr / dot(m, p + first, Ap);
+        for (r = 0; r < m; r++) {
+            x[r] += alpha*p[first + r];
+            res[r] -= alpha*Ap[r];
+        }
+        rrNew = dot(m, res, res);
+        /* the new direction of this rank's rows, then everybody's */
+        for (r = 0; r < m; r++)
+            Ap[r] = res[r] + rrNew/rr*p[first + r];
+        MPI_Allgatherv(Ap, m, MPI_DOUBLE, p, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+        rr = rrNew;
+    }
+    rr = sqrt(dot(m, x, x));
+
+    proxy_freeCSR(&A);
+    free(counts);
+    free(displs);
+    free(p);
+    free(x);
+    free(res);
+    free(Ap);
+    return rr;
+}
@@ -0,0 +1,53 @@
+############### Injector Parameters ##################
+#
+#    config - config file used by the compiler pass
+#    funcList - list of functions that are faulty
+#    prob - probability that instuction is faulty
+#    byte - which byte is faulty (0-7) -1 random
+#    singleInj - one injection per active rank (0 or 1)
+#    ptr - add code to inject into pointers (0 or 1)
+#    arith - add code to inject into mathematics (0 or 1)
+#    ctrl - add code to inject into control (0 or 1)
+#    stateFile - unique counter for fault site index;
+#                should differ based on application
+#
+#    The campaigns inject with the countdown (main.c's
+#    --countdown) or a plan file, so prob only has to be
+#    small enough never to fire on its own.
+#
+#####################################################
+
+config = "proxy.config"
+funcList = "\"\""
+prob = 1e-12
+byte = -1
+bit = -1
+ptr = 1
+arith = 1
+ctrl = 1
+stateFile = "proxy"
+
+############# Library Parameters #####################
+#
+#    FLIPIT_PATH - Path to FlipIt repo
+#    SHOW - include paths wrapped by mpicc (from mpicc -show)
+#
+#####################################################
+import os
+FLIPIT_PATH = os.environ['FLIPIT_PATH']
+LLVM_BUILD_PATH = os.environ['LLVM_BUILD_PATH']
+SHOW = " ".join(os.popen("mpicc -show").read().split()[1:])
+CPP_LIB = " " # not needed (C kernels)
+
+
+########### Files to NOT inject inside ###############
+notInject = ["main.c", " "]
+
+############ Default Compiler #################
+cc = "mpicc"
+
+############ Verbose compiler output ##############
+verbose = False
+
+############ Generate a histogram of fault site traversals #########
+histogram = False
@@ -0,0 +1,105 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: fft.c                                                                                 */
+/*                                                                                             */
+/* Description: Batched complex FFTs: every rank transforms PROXY_FFT_BATCH signals of length  */
+/*              n (rounded up to a power of two) forward and back again with an iterative      */
+/*              radix-2 transform, iters times. The result is the energy of the last forward  */
+/*              spectra plus the sum of the recovered signals, reduced over the ranks.        */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+
+#define PROXY_FFT_BATCH 16
+
+const char* proxy_name = "fft";
+const int proxy_default_n = 16384;
+const int proxy_default_iters = 10;
+
+/* in place; sign -1 forward, +1 inverse (unscaled) */
+static void fft(int n, double* re, double* im, const double* wr, const double* wi, int sign)
+{
+    int i, j, k, len, half, step;
+    double tr, ti;
+
+    for (i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            tr = re[i]; re[i] = re[j]; re[j] = tr;
+            ti = im[i]; im[i] = im[j]; im[j] = ti;
+        }
+    }
+    for (len = 2; len <= n; len <<= 1) {
+        half = len >> 1;
+        step = n / len;
+        for (i = 0; i < n; i += len)
+            for (k = 0; k < half; k++) {
+                double cr = wr[k*step], ci = sign*wi[k*step];
+                double xr = re[i + k + half], xi = im[i + k + half];
+                tr = xr*cr - xi*ci;
+                ti = xr*ci + xi*cr;
+                re[i + k + half] = re[i + k] - tr;
+                im[i + k + half] = im[i + k] - ti;
+                re[i + k] += tr;
+                im[i + k] += ti;
+            }
+    }
+}
+
+double proxy_run(ProxyArgs* args)
+{
+    int n = 1, b, i, it;
+    double *re, *im, *wr, *wi;
+    double local = 0., sum;
+
+    while (n < args->n)
+        n <<= 1;
+    args->n = n;
+    re = (double*) malloc((size_t) PROXY_FFT_BATCH*n*sizeof(double));
+    im = (double*) malloc((size_t) PROXY_FFT_BATCH*n*sizeof(double));
+    wr = (double*) malloc(n/2*sizeof(double) + sizeof(double));
+    wi = (double*) malloc(n/2*sizeof(double) + sizeof(double));
+    for (i = 0; i < n/2; i++) {
+        wr[i] = cos(2.*M_PI*i/n);
+        wi[i] = sin(2.*M_PI*i/n);
+    }
+    for (b = 0; b < PROXY_FFT_BATCH; b++)
+        for (i = 0; i < n; i++) {
+            re[(size_t) b*n + i] = sin(0.01*(i + 1)*(b + args->rank + 1));
+            im[(size_t) b*n + i] = 0.;
+        }
+
+    for (it = 0; it < args->iters; it++) {
+        local = 0.;
+        for (b = 0; b < PROXY_FFT_BATCH; b++) {
+            double* r = re + (size_t) b*n;
+            double* m = im + (size_t) b*n;
+            fft(n, r, m, wr, wi, -1);
+            for (i = 0; i < n; i++)
+                local += (r[i]*r[i] + m[i]*m[i]) / n;
+            fft(n, r, m, wr, wi, 1);
+            for (i = 0; i < n; i++) {
+                r[i] /= n;
+                m[i] /= n;
+            }
+        }
+    }
+    for (i = 0; i < PROXY_FFT_BATCH*n; i++)
+        local += re[i];
+    MPI_Allreduce(&local, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    free(re);
+    free(im);
+    free(wr);
+    free(wi);
+    return sum;
+}
@@ -0,0 +1,90 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: lu.c                                                                                  */
+/*                                                                                             */
+/* Description: Dense LU factorization with partial pivoting of an n x n matrix, iters times.  */
+/*              Rows are distributed cyclically and are not swapped: every step reduces the    */
+/*              largest candidate pivot over the ranks (MPI_MAXLOC), its owner broadcasts the  */
+/*              pivot row, and every rank eliminates the column from its remaining rows. The  */
+/*              result is log |det A| from the pivots.                                         */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+
+const char* proxy_name = "lu";
+const int proxy_default_n = 384;
+const int proxy_default_iters = 2;
+
+/* a deterministic value in [-1, 1) for every entry */
+static double entry(int i, int j)
+{
+    unsigned long long h = (unsigned long long) i*0x9E3779B97F4A7C15ULL
+                           ^ (unsigned long long) (j + 1)*0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return (double) (h >> 11) / (double) (1ULL << 52) - 1.;
+}
+
+double proxy_run(ProxyArgs* args)
+{
+    int n = args->n, rows = 0, it, i, j, k, r;
+    double* a;
+    double* pivotRow = (double*) malloc(n*sizeof(double));
+    int* used;
+    double logdet = 0.;
+    struct { double val; int row; } cand, best;
+
+    for (i = args->rank; i < n; i += args->size)
+        rows++;
+    a = (double*) malloc((size_t) (rows + 1)*n*sizeof(double));
+    used = (int*) malloc((rows + 1)*sizeof(int));
+
+    for (it = 0; it < args->iters; it++) {
+        for (r = 0; r < rows; r++) {
+            used[r] = 0;
+            for (j = 0; j < n; j++)
+                a[(size_t) r*n + j] = entry(args->rank + r*args->size, j);
+        }
+        logdet = 0.;
+        for (k = 0; k < n; k++) {
+            cand.val = -1.;
+            cand.row = -1;
+            for (r = 0; r < rows; r++)
+                if (!used[r] && fabs(a[(size_t) r*n + k]) > cand.val) {
+                    cand.val = fabs(a[(size_t) r*n + k]);
+                    cand.row = args->rank + r*args->size;
+                }
+            MPI_Allreduce(&cand, &best, 1, MPI_DOUBLE_INT, MPI_MAXLOC, MPI_COMM_WORLD);
+            if (best.row % args->size == args->rank) {
+                r = best.row / args->size;
+                used[r] = 1;
+                memcpy(pivotRow + k, a + (size_t) r*n + k, (n - k)*sizeof(double));
+            }
+            MPI_Bcast(pivotRow + k, n - k, MPI_DOUBLE, best.row % args->size, MPI_COMM_WORLD);
+            logdet += log(fabs(pivotRow[k]));
+
+            for (r = 0; r < rows; r++) {
+                double* row = a + (size_t) r*n;
+                double l;
+                if (used[r])
+                    continue;
+                l = row[k] / pivotRow[k];
+                row[k] = l;
+                for (j = k + 1; j < n; j++)
+                    row[j] -= l*pivotRow[j];
+            }
+        }
+    }
+
+    free(a);
+    free(pivotRow);
+    free(used);
+    return logdet;
+}
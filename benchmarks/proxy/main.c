@@ -0,0 +1,113 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: main.c                                                                                */
+/*                                                                                             */
+/* Description: Driver of the proxy kernels. Only the kernel is timed, and rank 0 prints       */
+/*                                                                                             */
+/*                  PROXY <kernel> n=<n> iters=<iters> ranks=<ranks> time=<s> result=<r>       */
+/*                                                                                             */
+/*              With --expect <r> a result that differs from r by more than --tolerance        */
+/*              (relative) also prints PROXY_SDC, for the campaign's sdc_pattern. With         */
+/*              --countdown <e> every rank injects after a random number (1..e, from the      */
+/*              runtime's seed) of fault site executions, so a campaign gets one fault per     */
+/*              rank per trial. Every other argument is left to FLIPIT_Init.                   */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+#include "corrupt.h"
+
+int main(int argc, char** argv)
+{
+    ProxyArgs args;
+    double expect = NAN, tolerance = 1e-9, result, t;
+    unsigned long countdown = 0;
+    int i;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &args.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &args.size);
+    args.n = proxy_default_n;
+    args.iters = proxy_default_iters;
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp("-n", argv[i]) == 0)
+            args.n = atoi(argv[++i]);
+        else if (strcmp("-it", argv[i]) == 0)
+            args.iters = atoi(argv[++i]);
+        else if (strcmp("--expect", argv[i]) == 0)
+            expect = strtod(argv[++i], NULL);
+        else if (strcmp("--tolerance", argv[i]) == 0)
+            tolerance = strtod(argv[++i], NULL);
+        else if (strcmp("--countdown", argv[i]) == 0)
+            countdown = strtoul(argv[++i], NULL, 0);
+    }
+
+    FLIPIT_Init(args.rank, argc, argv, 533);
+    if (countdown > 0)
+        FLIPIT_CountdownTimer(1 + rand() % countdown);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    result = proxy_run(&args);
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime() - t;
+
+    if (args.rank == 0) {
+        printf("PROXY %s n=%d iters=%d ranks=%d time=%.6f result=%.17g\n", proxy_name, args.n,
+               args.iters, args.size, t, result);
+        if (!isnan(expect) && !(fabs(result - expect) <= tolerance*fabs(expect)))
+            printf("PROXY_SDC expected=%.17g\n", expect);
+    }
+    /* only the profiling runtime writes histogram_<rank> */
+    FLIPIT_Finalize("histogram");
+    MPI_Finalize();
+    return 0;
+}
+
+void proxy_block(int n, int rank, int size, int* first, int* last)
+{
+    *first = (int) ((long long) n*rank/size);
+    *last = (int) ((long long) n*(rank + 1)/size);
+}
+
+void proxy_laplacian(int n, int first, int last, ProxyCSR* A)
+{
+    int r, k = 0;
+    A->rows = last - first;
+    A->first = first;
+    A->rowStart = (int*) malloc((A->rows + 1)*sizeof(int));
+    A->col = (int*) malloc(5*A->rows*sizeof(int));
+    A->val = (double*) malloc(5*A->rows*sizeof(double));
+    for (r = first; r < last; r++) {
+        int x = r % n, y = r / n;
+        A->rowStart[r - first] = k;
+        if (y > 0)     { A->col[k] = r - n; A->val[k++] = -1.; }
+        if (x > 0)     { A->col[k] = r - 1; A->val[k++] = -1.; }
+        A->col[k] = r; A->val[k++] = 4.;
+        if (x < n - 1) { A->col[k] = r + 1; A->val[k++] = -1.; }
+        if (y < n - 1) { A->col[k] = r + n; A->val[k++] = -1.; }
+    }
+    A->rowStart[A->rows] = k;
+}
+
+void proxy_freeCSR(ProxyCSR* A)
+{
+    free(A->rowStart);
+    free(A->col);
+    free(A->val);
+}
+
+void proxy_gatherLayout(int n, int size, int* counts, int* displs)
+{
+    int r, first, last;
+    for (r = 0; r < size; r++) {
+        proxy_block(n, r, size, &first, &last);
+        counts[r] = last - first;
+        displs[r] = first;
+    }
+}
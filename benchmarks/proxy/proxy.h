@@ -0,0 +1,56 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: proxy.h                                                                               */
+/*                                                                                             */
+/* Description: Interface between the benchmark driver (main.c, never instrumented) and the    */
+/*              proxy kernels (cg.c, spmv.c, stencil.c, fft.c, lu.c), which are built once    */
+/*              natively and once through flipit-cc. Every kernel is linked into its own       */
+/*              binary and defines the symbols below.                                          */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <mpi.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int n;          /* problem size (grid points per dimension, vector length, or order) */
+    int iters;      /* iterations, or repetitions of a kernel that has none */
+    int rank;
+    int size;
+} ProxyArgs;
+
+/* 5-point Laplacian of an n x n grid, the rows first..last-1 of it (CG and SpMV) */
+typedef struct {
+    int rows;
+    int first;
+    int* rowStart;
+    int* col;
+    double* val;
+} ProxyCSR;
+
+extern const char* proxy_name;
+extern const int proxy_default_n;
+extern const int proxy_default_iters;
+
+/* runs the kernel and returns a result that is the same on every rank */
+double proxy_run(ProxyArgs* args);
+
+/* helpers in main.c: the block of the rows 0..n-1 a rank owns, the Laplacian, and the counts
+   and displacements of an MPI_Allgatherv of block distributed rows */
+void proxy_block(int n, int rank, int size, int* first, int* last);
+void proxy_laplacian(int n, int first, int last, ProxyCSR* A);
+void proxy_freeCSR(ProxyCSR* A);
+void proxy_gatherLayout(int n, int size, int* counts, int* displs);
+
+#endif
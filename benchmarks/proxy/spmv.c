@@ -0,0 +1,62 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: spmv.c                                                                                */
+/*                                                                                             */
+/* Description: Sparse matrix-vector products in CSR: power iteration on the 5-point          */
+/*              Laplacian of an n x n grid. Every rank multiplies its block of rows and the    */
+/*              normalized vector is gathered on every rank. The result is the last norm, an  */
+/*              estimate of the largest eigenvalue.                                            */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+
+const char* proxy_name = "spmv";
+const int proxy_default_n = 256;
+const int proxy_default_iters = 200;
+
+double proxy_run(ProxyArgs* args)
+{
+    int N = args->n*args->n, first, last, it, r, k;
+    int* counts = (int*) malloc(args->size*sizeof(int));
+    int* displs = (int*) malloc(args->size*sizeof(int));
+    double* x = (double*) malloc(N*sizeof(double));
+    double* y;
+    double norm = 0., local;
+    ProxyCSR A;
+
+    proxy_block(N, args->rank, args->size, &first, &last);
+    proxy_laplacian(args->n, first, last, &A);
+    proxy_gatherLayout(N, args->size, counts, displs);
+    y = (double*) malloc((A.rows + 1)*sizeof(double));
+    for (r = 0; r < N; r++)
+        x[r] = 1. + (r % 7)*0.125;
+
+    for (it = 0; it < args->iters; it++) {
+        local = 0.;
+        for (r = 0; r < A.rows; r++) {
+            double sum = 0.;
+            for (k = A.rowStart[r]; k < A.rowStart[r + 1]; k++)
+                sum += A.val[k]*x[A.col[k]];
+            y[r] = sum;
+            local += sum*sum;
+        }
+        MPI_Allreduce(&local, &norm, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        norm = sqrt(norm);
+        for (r = 0; r < A.rows; r++)
+            y[r] /= norm;
+        MPI_Allgatherv(y, A.rows, MPI_DOUBLE, x, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+    }
+
+    proxy_freeCSR(&A);
+    free(counts);
+    free(displs);
+    free(x);
+    free(y);
+    return norm;
+}
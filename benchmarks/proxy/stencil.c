@@ -0,0 +1,64 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: stencil.c                                                                             */
+/*                                                                                             */
+/* Description: 7-point Jacobi sweeps of the Poisson equation on an n x n x n grid with zero   */
+/*              boundaries and a unit source. Ranks own slabs of z planes and swap one halo    */
+/*              plane with each neighbor per sweep. The result is the sum of the solution.    */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "proxy.h"
+
+const char* proxy_name = "stencil";
+const int proxy_default_n = 48;
+const int proxy_default_iters = 100;
+
+double proxy_run(ProxyArgs* args)
+{
+    int n = args->n, p = n + 2, plane = p*p, first, last, nz, it, x, y, z;
+    int up = args->rank + 1 < args->size ? args->rank + 1 : MPI_PROC_NULL;
+    int down = args->rank > 0 ? args->rank - 1 : MPI_PROC_NULL;
+    double *u, *v, *tmp;
+    double h2, local = 0., sum;
+
+    proxy_block(n, args->rank, args->size, &first, &last);
+    nz = last - first;
+    /* planes 0 and nz+1 are halos, and every plane has a border of zeros */
+    u = (double*) calloc((size_t) (nz + 2)*plane, sizeof(double));
+    v = (double*) calloc((size_t) (nz + 2)*plane, sizeof(double));
+    h2 = 1. / ((double) (n + 1)*(n + 1));
+
+    for (it = 0; it < args->iters; it++) {
+        MPI_Sendrecv(u + (size_t) nz*plane, plane, MPI_DOUBLE, up, 0,
+                     u, plane, MPI_DOUBLE, down, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(u + plane, plane, MPI_DOUBLE, down, 1,
+                     u + (size_t) (nz + 1)*plane, plane, MPI_DOUBLE, up, 1, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+        for (z = 1; z <= nz; z++)
+            for (y = 1; y <= n; y++)
+                for (x = 1; x <= n; x++) {
+                    size_t i = (size_t) z*plane + y*p + x;
+                    v[i] = (u[i - 1] + u[i + 1] + u[i - p] + u[i + p] + u[i - plane]
+                            + u[i + plane] + h2) / 6.;
+                }
+        tmp = u;
+        u = v;
+        v = tmp;
+    }
+
+    for (z = 1; z <= nz; z++)
+        for (y = 1; y <= n; y++)
+            for (x = 1; x <= n; x++)
+                local += u[(size_t) z*plane + y*p + x];
+    MPI_Allreduce(&local, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    free(u);
+    free(v);
+    return sum;
+}
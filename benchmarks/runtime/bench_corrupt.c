@@ -0,0 +1,188 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: bench_corrupt.c                                                                       */
+/*                                                                                             */
+/* Description: Micro-benchmark of the functions the compiler pass inserts at every fault     */
+/*              site. Each function is timed disarmed, armed but not firing, and firing, along */
+/*              with the countdown probability function and the fault site filter at several  */
+/*              list sizes. Results are printed as CSV to stdout:                             */
+/*                                                                                             */
+/*                  build,function,state,ops,ns_per_op,insts_per_op                            */
+/*                                                                                             */
+/*              insts_per_op comes from perf_event_open and is -1 when the counter is not     */
+/*              available (e.g. kernel.perf_event_paranoid or no PMU in a VM).                */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "corrupt.h"
+
+#ifdef FLIPIT_HISTOGRAM
+#define BENCH_BUILD "histogram"
+#else
+#define BENCH_BUILD "default"
+#endif
+
+#define BENCH_OPS 10000000ULL
+#define BENCH_FIRING_OPS 100000ULL
+#define BENCH_SITE 7
+#define BENCH_PARAM (0xFF000000 | BENCH_SITE)
+
+static FILE* results;
+static int perfFd = -1;
+
+/* counts user-space instructions of this thread; -1 if unavailable */
+static int bench_openCounter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static double bench_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1e9 + t.tv_nsec;
+}
+
+/* (re)initialize the runtime from a command line like the one given to an application */
+static void bench_init(int argc, char** argv) {
+    FLIPIT_Init(0, argc, argv, 533);
+    FLIPIT_SetMaxInjections(INT_MAX);
+}
+
+#define BENCH_LOOP(name, state, ops, type, call)                                               \
+    do {                                                                                       \
+        type x = (type) 1;                                                                     \
+        uint64_t i;                                                                            \
+        long long insts = -1;                                                                  \
+        double start, stop;                                                                    \
+        if (perfFd >= 0) {                                                                     \
+            ioctl(perfFd, PERF_EVENT_IOC_RESET, 0);                                            \
+            ioctl(perfFd, PERF_EVENT_IOC_ENABLE, 0);                                           \
+        }                                                                                      \
+        start = bench_now();                                                                   \
+        for (i = 0; i < (ops); i++)                                                            \
+            x = call;                                                                          \
+        stop = bench_now();                                                                    \
+        if (perfFd >= 0) {                                                                     \
+            ioctl(perfFd, PERF_EVENT_IOC_DISABLE, 0);                                          \
+            if (read(perfFd, &insts, sizeof(insts)) != sizeof(insts))                          \
+                insts = -1;                                                                    \
+        }                                                                                      \
+        fprintf(results, "%s,%s,%s,%llu,%.3f,%.2f\n", BENCH_BUILD, name, state,                \
+                (unsigned long long) (ops), (stop - start) / (ops),                            \
+                insts < 0 ? -1. : (double) insts / (ops));                                     \
+        if (x == (type) 42) fprintf(stderr, " ");  /* keep x alive */                         \
+    } while (0)
+
+/* all corruption functions in one state */
+static void bench_functions(char* state, double prob, uint64_t ops) {
+    /* one random 64-bit site */
+    uint32_t layout = FLIPIT_INLINE_RANDOM << 16 | 8 << 8;
+
+    BENCH_LOOP("corruptIntData_64bit", state, ops, uint64_t,
+               corruptIntData_64bit(BENCH_PARAM, prob, x));
+    BENCH_LOOP("corruptFloatData_32bit", state, ops, float,
+               corruptFloatData_32bit(BENCH_PARAM, prob, x));
+    BENCH_LOOP("corruptFloatData_64bit", state, ops, double,
+               corruptFloatData_64bit(BENCH_PARAM, prob, x));
+    BENCH_LOOP("corruptPtr2Int_64bit", state, ops, uint64_t,
+               corruptPtr2Int_64bit(BENCH_PARAM, prob, x));
+
+    /* specialized entry points: fixed byte and bit, and fully random */
+    BENCH_LOOP("corruptIntData_64bit_fixed", state, ops, uint64_t,
+               corruptIntData_64bit_fixed(BENCH_SITE, prob, x, 3, 8));
+    BENCH_LOOP("corruptIntData_64bit_random", state, ops, uint64_t,
+               corruptIntData_64bit_random(BENCH_SITE, prob, x, 0, 8));
+    BENCH_LOOP("corruptFloatData_32bit_fixed", state, ops, float,
+               corruptFloatData_32bit_fixed(BENCH_SITE, prob, x, 3, 4));
+    BENCH_LOOP("corruptFloatData_32bit_random", state, ops, float,
+               corruptFloatData_32bit_random(BENCH_SITE, prob, x, 0, 4));
+    BENCH_LOOP("corruptFloatData_64bit_fixed", state, ops, double,
+               corruptFloatData_64bit_fixed(BENCH_SITE, prob, x, 3, 8));
+    BENCH_LOOP("corruptFloatData_64bit_random", state, ops, double,
+               corruptFloatData_64bit_random(BENCH_SITE, prob, x, 0, 8));
+    BENCH_LOOP("corruptPtr2Int_64bit_fixed", state, ops, uint64_t,
+               corruptPtr2Int_64bit_fixed(BENCH_SITE, prob, x, 3, 8));
+    BENCH_LOOP("corruptPtr2Int_64bit_random", state, ops, uint64_t,
+               corruptPtr2Int_64bit_random(BENCH_SITE, prob, x, 0, 8));
+
+    /* inline mask mode: the only call is on function entry */
+    BENCH_LOOP("flipit_inlineArm", state, ops, uint32_t,
+               flipit_inlineArm(BENCH_SITE, 1, prob, &layout));
+}
+
+/* a fault site list of n entries that does not contain BENCH_SITE, so every call scans it */
+static void bench_siteFilter(int n) {
+    char** argv = (char**) malloc((n + 5) * sizeof(char*));
+    char state[64];
+    int i;
+
+    argv[0] = "bench";
+    argv[1] = "-nLOC";
+    argv[2] = (char*) malloc(16);
+    snprintf(argv[2], 16, "%d", n);
+    argv[3] = "-fLOC";
+    for (i = 0; i < n; i++) {
+        argv[4 + i] = (char*) malloc(16);
+        snprintf(argv[4 + i], 16, "%d", BENCH_SITE + 1 + i);
+    }
+    /* the runtime of the previous size goes away with its list and histogram */
+    FLIPIT_Finalize(NULL);
+    bench_init(4 + n, argv);
+    snprintf(state, sizeof(state), "site_filter_%d", n);
+    BENCH_LOOP("corruptFloatData_64bit", state, BENCH_OPS / (n > 64 ? n / 64 : 1), double,
+               corruptFloatData_64bit(BENCH_PARAM, 1.0, x));
+
+    for (i = 0; i < n; i++)
+        free(argv[4 + i]);
+    free(argv[2]);
+    free(argv);
+}
+
+int main(int argc, char** argv) {
+    int sizes[] = {1, 16, 256, 4096};
+    uint32_t i;
+
+    /* the injection reports of the firing state go to /dev/null, results to the real stdout */
+    results = fdopen(dup(fileno(stdout)), "w");
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 1;
+    perfFd = bench_openCounter();
+
+    fprintf(results, "build,function,state,ops,ns_per_op,insts_per_op\n");
+    bench_init(argc, argv);
+
+    FLIPIT_SetInjector(FLIPIT_OFF);
+    bench_functions("disarmed", 1.0, BENCH_OPS);
+
+    FLIPIT_SetInjector(FLIPIT_ON);
+    bench_functions("armed", 0.0, BENCH_OPS);
+    bench_functions("firing", 1.0, BENCH_FIRING_OPS);
+
+    /* countdown far in the future: the probability function runs but never fires */
+    FLIPIT_CountdownTimer(~0UL);
+    BENCH_LOOP("corruptFloatData_64bit", "countdown", BENCH_OPS, double,
+               corruptFloatData_64bit(BENCH_PARAM, 0.0, x));
+    FLIPIT_SetFaultProbability(drand48);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(int); i++)
+        bench_siteFilter(sizes[i]);
+
+    FLIPIT_Finalize(NULL);
+    fclose(results);
+    return 0;
+}
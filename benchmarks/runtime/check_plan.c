@@ -0,0 +1,125 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: check_plan.c                                                                          */
+/*                                                                                             */
+/* Description: Checks that a runtime with a plan file (--plan) only injects the planned       */
+/*              faults. The plan has one fault for rank 1. Rank 0 has none and must never      */
+/*              inject, even though every site is called with probability 1; rank 1 must flip  */
+/*              exactly the planned execution and nothing after it. Exits nonzero and names    */
+/*              the failing entry point otherwise. Run with make check.                        */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "corrupt.h"
+
+#define CHECK_SITE 7
+#define CHECK_PARAM (0xFF000000 | CHECK_SITE)
+#define CHECK_INSTANCE 3
+#define CHECK_BIT 5
+#define CHECK_CALLS 10
+
+static int failures = 0;
+
+static void check_writePlan(char* name) {
+    FLIPIT_PlanHeader header = { FLIPIT_PLAN_MAGIC, 1 };
+    FLIPIT_PlanEntry entry = { 0, 1, 0, CHECK_SITE, CHECK_INSTANCE, CHECK_BIT, 0 };
+    FILE* f = fopen(name, "wb");
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(&entry, sizeof(entry), 1, f);
+    fclose(f);
+}
+
+static void check_init(uint32_t rank, char* plan) {
+    char* argv[] = { "check_plan", "--plan", plan, NULL };
+    FLIPIT_Finalize(NULL);
+    FLIPIT_Init(rank, 3, argv, 533);
+    FLIPIT_SetMaxInjections(INT_MAX);
+}
+
+/* calls an entry point CHECK_CALLS times at CHECK_SITE with probability 1 and counts the calls
+   that changed their value, the first of which has to be the planned one */
+#define CHECK_ENTRY(name, call, T, expected)                                                   \
+    do {                                                                                       \
+        int i, changed = 0, first = -1;                                                        \
+        for (i = 0; i < CHECK_CALLS; i++) {                                                    \
+            T x = (T) 1;                                                                       \
+            if (call != x) {                                                                   \
+                changed++;                                                                     \
+                if (first < 0) first = i + 1;                                                  \
+            }                                                                                  \
+        }                                                                                      \
+        if (changed != expected || (expected && first != CHECK_INSTANCE)) {                    \
+            fprintf(stderr, "FAILED rank %u %s: %d injections (first %d), expected %d\n",      \
+                    rank, name, changed, first, expected);                                     \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+static void check_rank(uint32_t rank, char* plan, int planned) {
+    int64_t bit;
+    int i, payloads = 0;
+    unsigned long long executed;
+
+    check_init(rank, plan);
+    /* the entries taking the old 32-bit parameter know nothing of plans and never inject */
+    CHECK_ENTRY("corruptIntData_64bit", corruptIntData_64bit(CHECK_PARAM, 1.0, x), uint64_t, 0);
+    check_init(rank, plan);
+    CHECK_ENTRY("corruptFloatData_64bit", corruptFloatData_64bit(CHECK_PARAM, 1.0, x),
+                double, 0);
+    check_init(rank, plan);
+    CHECK_ENTRY("corruptIntData_64bit_random",
+                corruptIntData_64bit_random(CHECK_SITE, 1.0, x, 0, 8), uint64_t, planned);
+    check_init(rank, plan);
+    CHECK_ENTRY("corruptFloatData_32bit_fixed",
+                corruptFloatData_32bit_fixed(CHECK_SITE, 1.0, x, 3, 4), float, planned);
+
+    check_init(rank, plan);
+    executed = FLIPIT_GetExecutedInstructionCount();
+    for (i = 0; i < CHECK_CALLS; i++) {
+        bit = corruptPayloadBit(CHECK_SITE, 1.0, 16, "Payload");
+        if (bit >= 0) payloads++;
+    }
+    if (payloads != planned) {
+        fprintf(stderr, "FAILED rank %u corruptPayloadBit: %d injections, expected %d\n",
+                rank, payloads, planned);
+        failures++;
+    }
+    /* the crash record and the event log count executions the plan walks as well */
+    executed = FLIPIT_GetExecutedInstructionCount() - executed;
+    if (executed != CHECK_CALLS) {
+        fprintf(stderr, "FAILED rank %u corruptPayloadBit: %llu executions counted, expected %d\n",
+                rank, executed, CHECK_CALLS);
+        failures++;
+    }
+
+    /* the inline mask does not count executions, so a plan never arms it */
+    check_init(rank, plan);
+    for (i = 0; i < CHECK_CALLS; i++) {
+        if (flipit_inlineArm(CHECK_SITE, 1, 1.0, NULL) != FLIPIT_INLINE_NONE) {
+            fprintf(stderr, "FAILED rank %u flipit_inlineArm: armed a site\n", rank);
+            failures++;
+            break;
+        }
+    }
+    FLIPIT_Finalize(NULL);
+}
+
+int main(int argc, char** argv) {
+    char plan[] = "check_plan.bin";
+
+    /* the injection reports go to /dev/null */
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 1;
+    check_writePlan(plan);
+    check_rank(0, plan, 0);
+    check_rank(1, plan, 1);
+    remove(plan);
+
+    fprintf(stderr, "%s\n", failures == 0 ? "check_plan: passed" : "check_plan: FAILED");
+    return failures != 0;
+}
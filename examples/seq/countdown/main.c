@@ -9,6 +9,7 @@ int main(int argc, char** argv)
 	double* b = (double*) malloc(n*n*sizeof(double));
 	double* c = (double*) malloc(n*n*sizeof(double));
 	double* c_golden = (double*) malloc(n*n*sizeof(double));
+	FLIPIT_CompareResult result;
 
 	/* Initialize arrays */
 	for (i=0; i<n; i++)
@@ -34,13 +35,13 @@ int main(int argc, char** argv)
 	FLIPIT_SetInjector(FLIPIT_ON);
 	matmul(a, b, c, n);
 
-	/* check */
-	for (i=0; i<n; i++)
-		for (j=0; j<n; j++)
-			if (c[i*n + j] != c_golden[i*n +j])
-				numIncorrect += 1;
+	/* check (exact match, no tolerance) */
+	numIncorrect = FLIPIT_CompareBuffers(c, c_golden, n*n, FLIPIT_DOUBLE, 0., 0, &result);
 
 	printf("Number of incorrect elements: %d\n", numIncorrect);
+	if (numIncorrect > 0)
+		printf("First incorrect element: %lld (max relative error %e)\n",
+			(long long) result.firstIndex, result.maxRelError);
 	FLIPIT_Finalize(NULL);
 
 	return 0;
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include "matmul.h"
+#include "FlipIt/corrupt/corrupt.h"
+
+/* Runs many injection trials in one process with the persistent trial loop. Each trial
+   injects after a different number of instructions, a crash in a trial is recovered from,
+   and every trial ends with a "FLIPIT_EVENT trial" record. */
+
+struct problem {
+	int n;
+	double *a, *b, *c, *c_golden;
+};
+
+static void trial(void* arg)
+{
+	struct problem* p = (struct problem*) arg;
+	memset(p->c, 0, p->n*p->n*sizeof(double));
+	matmul(p->a, p->b, p->c, p->n);
+	FLIPIT_CompareBuffers(p->c, p->c_golden, p->n*p->n, FLIPIT_DOUBLE, 0., 0, NULL);
+}
+
+int main(int argc, char** argv)
+{
+	int n = 100, seed = 533, numTrials = 1000, numCrashed = 0, t, i, j;
+	struct problem p;
+	p.n = n;
+	p.a = (double*) malloc(n*n*sizeof(double));
+	p.b = (double*) malloc(n*n*sizeof(double));
+	p.c = (double*) malloc(n*n*sizeof(double));
+	p.c_golden = (double*) malloc(n*n*sizeof(double));
+
+	/* Initialize arrays */
+	for (i=0; i<n; i++)
+		for(j=0; j<n; j++)
+		{
+			p.a[i*n + j] = i*j;
+			p.b[i*n + j] = i*j;
+			p.c_golden[i*n + j] = 0;
+		}
+	FLIPIT_Init(0, argc, argv, seed);
+	FLIPIT_SetInjector(FLIPIT_OFF);
+	matmul(p.a, p.b, p.c_golden, n);
+
+	/* Use FLIPIT_SetTrialIsolation(FLIPIT_TRIAL_FORK) if a trial may corrupt the heap */
+	FLIPIT_SetInjector(FLIPIT_ON);
+	for (t = 0; t < numTrials; t++) {
+		FLIPIT_CountdownTimer(125 + t*997);
+		if (FLIPIT_RunTrial(seed + t, trial, &p) == FLIPIT_TRIAL_CRASHED)
+			numCrashed++;
+	}
+
+	printf("Trials: %d Crashed: %d\n", numTrials, numCrashed);
+	FLIPIT_Finalize(NULL);
+
+	return 0;
+}
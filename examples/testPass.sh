@@ -31,8 +31,7 @@ echo "int work(int a, int b)
 
 # compile work.c
 $LLVM_BUILD_PATH/bin/clang  -g -emit-llvm work.c  -c -o work.bc 
-$LLVM_BUILD_PATH/bin/llvm-link $FLIPIT_PATH/include/FlipIt/corrupt/corrupt.bc work.bc  -o crpt_work.bc
-$LLVM_BUILD_PATH/bin/opt -load $FLIPIT_PATH/lib/libFlipItPass.so -FlipIt -srcFile "work.c" -singleInj 1 -prob 0.95 -byte -1 -bit 0 -arith 1 -ctrl 0 -ptr 0 -funcList "" crpt_work.bc  -o final.bc
+$LLVM_BUILD_PATH/bin/opt -load $FLIPIT_PATH/lib/libFlipItPass.so -FlipIt -srcFile "work.c" -singleInj 1 -prob 0.95 -byte -1 -bit 0 -arith 1 -ctrl 0 -ptr 0 -funcList "" work.bc  -o final.bc
 $LLVM_BUILD_PATH/bin/clang  -fPIC -g -c final.bc -o final.o  
 
 # display the compiler log file for work.LLVM.txt
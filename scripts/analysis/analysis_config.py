@@ -80,3 +80,4 @@ detectMessage = "Foo Check"
 bitMessage = "Bit position"
 siteMessage = "/*********************************Start**************************************/"
 siteEndMessage = "/*********************************End**************************************/"
+eventMessage = "FLIPIT_EVENT"
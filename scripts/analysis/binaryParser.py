@@ -28,8 +28,14 @@ def unpack(binary, fmt, size = None):
     elif fmt == 'H':
         value = struct.unpack(fmt, binary[currSize:currSize+2])[0]
         currSize += 2
-    elif fmt == 'L':
-        value = struct.unpack(fmt, binary[currSize:currSize+8])[0]
+    elif fmt == 'I':
+        value = struct.unpack('=I', binary[currSize:currSize+4])[0]
+        currSize += 4
+    elif fmt == 'f':
+        value = struct.unpack('=f', binary[currSize:currSize+4])[0]
+        currSize += 4
+    elif fmt == 'Q':
+        value = struct.unpack('=Q', binary[currSize:currSize+8])[0]
         currSize += 8
     elif fmt == 's':
         value = binary[currSize:currSize + size].decode("utf-8")
@@ -197,7 +203,12 @@ def opcode2Str(opcode):
 
 def parseBinaryLogFile(c, filename, outfile = None):
     """Reads FLipIt LLVM log file and adds fault injection site
-    information into the database.
+    information into the database. Version 2 log files also give the def-use
+    equivalence class of every site: the class is the site index of its
+    representative, and classSize the number of sites in it. Sites of
+    version 1 files are each their own class. Version 3 log files also give
+    the weight of every site, the pass's static estimate of how often it
+    executes per invocation of its function (NULL in older files).
     Parameters
     ----------
     c : object
@@ -227,6 +238,7 @@ def parseBinaryLogFile(c, filename, outfile = None):
         nameSize = unpack(logfile, 'H')
         srcFile = unpack(logfile, 's', nameSize)
         siteIdx = 0
+        funcStart = 0
         funcName = ""
 
 
@@ -238,7 +250,25 @@ def parseBinaryLogFile(c, filename, outfile = None):
         while currSize < len(logfile): # for rest of file
             #print "GET OPCODE"
             opcode = unpack(logfile, 'B') #read function header
-            if opcode != 255: 
+            if opcode == 254: # def-use classes of the sites of the function
+                count = unpack(logfile, 'I')
+                for i in range(count):
+                    offset = unpack(logfile, 'I')
+                    classSize = unpack(logfile, 'I')
+                    site = funcStart + i
+                    if c != None:
+                        c.execute("UPDATE sites SET class = ?, classSize = ? WHERE site=?", (site - offset, classSize, site))
+                    if outfile != None and offset == 0:
+                        outfile.write("\nClass #" + str(site) + "\tsize " + str(classSize))
+            elif opcode == 253: # static executions per invocation of the sites of the function
+                count = unpack(logfile, 'I')
+                for i in range(count):
+                    weight = unpack(logfile, 'f')
+                    if c != None:
+                        c.execute("UPDATE sites SET weight = ? WHERE site=?", (weight, funcStart + i))
+                    if outfile != None:
+                        outfile.write("\nWeight #" + str(funcStart + i) + "\t" + str(weight))
+            elif opcode != 255: 
                 # opcode(1 byte), Types/Info(1 byte [3,5 bits]), Location (2+ bytes)
                 info_type = unpack(logfile, 'B')
                 ty = info_type >> 5
@@ -262,7 +292,7 @@ def parseBinaryLogFile(c, filename, outfile = None):
                 msg += "\t" + srcFile + ":" + str(lineNum)
                 if c != None:                
                     #print msg
-                    c.execute("INSERT INTO sites VALUES (?,?,?,?,?,?,?)", (siteIdx, type2Str(ty), comment, srcFile, funcName, lineNum, opcode))
+                    c.execute("INSERT INTO sites VALUES (?,?,?,?,?,?,?,?,?,?)", (siteIdx, type2Str(ty), comment, srcFile, funcName, lineNum, opcode, siteIdx, 1, None))
                 if outfile != None:
                     outfile.write(msg)
                 siteIdx += 1
@@ -274,7 +304,8 @@ def parseBinaryLogFile(c, filename, outfile = None):
                     outfile.write("\n\nFunction Name: " + funcName)
                     outfile.write("\n------------------------------------------------------------------------------")
                 #print funcName
-                siteIdx = unpack(logfile, 'L')
+                siteIdx = unpack(logfile, 'Q')
+                funcStart = siteIdx
                 #print "Fault Site Idx: ", siteIdx
             #print currSize
 
@@ -282,6 +313,118 @@ def parseBinaryLogFile(c, filename, outfile = None):
         outfile.write("\n")
         outfile.close()
 
+SITES_MAGIC = 0x5345544953544946      # "FITSITES"
+SITES_SECTION = b"flipit_sites"
+
+
+def readSiteSection(filename):
+    """Returns the contents of the flipit_sites section of an ELF file and
+    the byte order of the file, or (None, None) if it has no such section.
+    Parameters
+    ----------
+    filename : str
+        name of an executable or object file compiled with FlipIt
+    """
+
+    with open(filename, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        return None, None
+    order = "<" if elf[5] == 1 else ">"
+    if elf[4] == 2: # ELF64
+        shoff, = struct.unpack_from(order + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x3A)
+        header = order + "IIQQQQ"
+    else:
+        shoff, = struct.unpack_from(order + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x2E)
+        header = order + "IIIIII"
+    sections = [struct.unpack_from(header, elf, shoff + i*shentsize) for i in range(shnum)]
+    if shstrndx >= len(sections):
+        return None, None
+    names = sections[shstrndx][4]
+    for name, ty, flags, addr, offset, size in sections:
+        end = elf.index(b"\0", names + name)
+        if elf[names + name:end] == SITES_SECTION and ty != 8: # not SHT_NOBITS
+            return elf[offset:offset + size], order
+    return None, None
+
+
+def readSiteTables(filename):
+    """Reads the site tables the FlipIt pass puts into the flipit_sites
+    section of every instrumented object (FLIPIT_SiteTable in corrupt.h).
+    Returns one (site, opcode, ty, info, file, function, line, class,
+    weight) tuple per fault site, where class is the site index of the
+    representative of its def-use class. Empty if the file has no tables.
+    Parameters
+    ----------
+    filename : str
+        name of an executable or object file compiled with FlipIt
+    """
+
+    data, order = readSiteSection(filename)
+    sites = []
+    pos = 0
+    while data != None and pos + 32 <= len(data):
+        magic, version, size, firstSite, numSites, numStrings = \
+            struct.unpack_from(order + "QIIQII", data, pos)
+        # the linker may pad between the tables of two objects
+        if magic != SITES_MAGIC or size < 32:
+            pos += 8
+            continue
+        strings = data[pos + 32 + 20*numSites:pos + size].split(b"\0")[:numStrings]
+        strings = [name.decode("utf-8") for name in strings]
+        for i in range(numSites):
+            line, fileIdx, funcIdx, opcode, info_type, reserved, offset, weight = \
+                struct.unpack_from(order + "IHHBBHIf", data, pos + 32 + 20*i)
+            site = firstSite + i
+            sites.append((site, opcode, info_type >> 5, info_type & 0x1F, strings[fileIdx],
+                          strings[funcIdx], line, site - offset, weight))
+        pos += size
+    return sites
+
+
+def parseBinarySiteTable(c, filename, outfile = None):
+    """Reads the site tables of an instrumented binary (see readSiteTables)
+    and adds fault injection site information into the database, the same
+    as parseBinaryLogFile does for the log files of its build. Returns the
+    number of sites read.
+    Parameters
+    ----------
+    c : object
+        sqlite3 database handle that is open to a valid filled database
+    filename : str
+        name of an executable or object file compiled with FlipIt
+    outfile : any
+        if value is not 'None' then this function will write an ASCII
+        version of the site tables to disk with the name 'outfile', or
+        'filename' with the extension .LLVM.txt if 'outfile' is ""
+    """
+
+    sites = readSiteTables(filename)
+    classSize = {}
+    for site in sites:
+        classSize[site[7]] = classSize.get(site[7], 0) + 1
+    if outfile != None:
+        outfile = open(outfile if outfile != "" else filename + ".LLVM.txt", "w")
+        outfile.write("Site tables of: " + filename)
+    funcName = None
+    for site, opcode, ty, info, srcFile, function, lineNum, cls, weight in sites:
+        comment = info2Str(info, opcode2Str(opcode))
+        if c != None:
+            c.execute("INSERT INTO sites VALUES (?,?,?,?,?,?,?,?,?,?)", (site, type2Str(ty), comment, srcFile, function, lineNum, opcode, cls, classSize[cls], weight))
+        if outfile != None:
+            if function != funcName:
+                outfile.write("\n\nFunction Name: " + function)
+                outfile.write("\n------------------------------------------------------------------------------")
+                funcName = function
+            outfile.write("\n#" + str(site) + "\t" + opcode2Str(opcode) + "\t" + comment\
+                + "\t" + type2Str(ty) + "\t" + srcFile + ":" + str(lineNum))
+    if outfile != None:
+        outfile.write("\n")
+        outfile.close()
+    return len(sites)
+
 #parseBinaryLogFile("work.c.LLVM.bin", "OUT.c.LLVM.txt")
 #parseBinaryLogFile("/home/aperson40/research/compilerSDC/HPCCG-1.0/ddot.cpp.LLVM.bin", "DD.c.LLVM.txt")
 
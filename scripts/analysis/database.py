@@ -59,11 +59,12 @@ def createTables(c):
     c : object
         sqlite3 database handle that is open to a valid filled database
     """
-    c.execute("CREATE TABLE sites (site int, type text, comment text, file text, function text, line int, opcode text)")
-    c.execute("CREATE TABLE trials (trial int, numInj int, crashed int, detection int, path text, signal int)")
+    c.execute("CREATE TABLE sites (site int, type text, comment text, file text, function text, line int, opcode text, class int, classSize int, weight double)")
+    c.execute("CREATE TABLE trials (trial int, numInj int, crashed int, detection int, path text, signal int, weight double)")
     c.execute("CREATE TABLE injections (trial int, site int, rank int, prob double, bit int, cycle int, notes text)")
     c.execute("CREATE TABLE signals (trial int, num int)")
     c.execute("CREATE TABLE detections (trial int, latency int, detector text)")
+    c.execute("CREATE TABLE events (trial int, rank int, event text, inst int, data text)")
     #c.execute("CREATE TABLE ()")
 
 
@@ -127,7 +128,7 @@ def parseInjLog(c, path,  file):
                 split = line.split(":")
                 srcLine = int(split[-1])
                 file = split[0]
-            c.execute("INSERT INTO sites VALUES (?,?,?,?,?,?,?)", (site, type, comment, file, funcName, srcLine, "Unknown"))
+            c.execute("INSERT INTO sites VALUES (?,?,?,?,?,?,?,?,?,?)", (site, type, comment, file, funcName, srcLine, "Unknown", site, 1, None))
 
 
 def readTrials(c, filePrefix, customParser = None):
@@ -161,7 +162,7 @@ def readTrials(c, filePrefix, customParser = None):
         t = open(path).readlines()
         llvmInj = injCount = crashed = detected = signal = arithFP = 0
        
-        c.execute("INSERT INTO trials(trial,path) VALUES (?,?)", (trial, path))
+        c.execute("INSERT INTO trials(trial,path,weight) VALUES (?,?,1.0)", (trial, path))
         # look at certain lines in output
         i = 0
         while i < len(t):
@@ -205,6 +206,9 @@ def readTrials(c, filePrefix, customParser = None):
                     customParser(c, " ".join(inj[j]), trial)
 
 
+            if l.startswith(eventMessage):
+                parseEvent(c, l, trial)
+
             if detectMessage in l:
                 detected = True
                 c.execute("SELECT * FROM DETECTIONS WHERE trial = ?", (trial,))
@@ -235,6 +239,32 @@ def readTrials(c, filePrefix, customParser = None):
         c.execute("UPDATE trials SET detection=? WHERE trials.trial=?", (detected, trial))
         c.execute("UPDATE trials SET signal=? WHERE trials.trial=?", (signal, trial))
 
+def parseEvent(c, line, trial):
+    """Adds a structured runtime event into the database. Events are lines of
+    the form 'FLIPIT_EVENT <event> rank=<rank> inst=<count> key=value ...'
+
+    Parameters
+    ----------
+    c : object
+        sqlite3 database handle that is open to a valid filled database
+    line : str
+        event line from the output file of a fault injection trial
+    trial: int
+        number of fault injection trial. obtained from filename
+    """
+    split = line.split()
+    if len(split) < 4:
+        return
+    fields = dict(f.split("=", 1) for f in split[2:] if "=" in f)
+    data = " ".join(split[4:])
+    c.execute("INSERT INTO events VALUES (?,?,?,?,?)", (trial, int(fields.get("rank", -1)),\
+        split[1], int(fields.get("inst", -1)), data))
+
+    # importance sampled campaigns (scripts/campaign) record the likelihood
+    # ratio of the trial so rates are weighted back to real faults
+    if split[1] == "plan" and "weight" in fields:
+        c.execute("UPDATE trials SET weight=? WHERE trials.trial=?", (float(fields["weight"]), trial))
+
 def finalize():
     """Cleans up fault injection visualization
     """
@@ -24,10 +24,11 @@ def initVis(c):
     """
 
     global numTrialsInj, numTrials
-    c.execute("SELECT * FROM trials WHERE trials.numInj > 0")
-    numTrialsInj = 1. * len(c.fetchall())
-    c.execute("SELECT * FROM trials")
-    numTrials = 1. * len(c.fetchall())
+    # trials count by their weight, which is 1 unless the campaign used importance sampling
+    c.execute("SELECT TOTAL(weight) FROM trials WHERE trials.numInj > 0")
+    numTrialsInj = c.fetchone()[0]
+    c.execute("SELECT TOTAL(weight) FROM trials")
+    numTrials = c.fetchone()[0]
     if numTrialsInj == 0:
         print "No injections found to visualize..."
         sys.exit(1)
@@ -167,8 +168,8 @@ def visClassifications(c, moreDetail=None):
     if len(injs) == 0:
         print "Error in visClassifications: No Injections\n"
         return
-    maximum = max(injs)[0] +1
-    locs = np.zeros((nClassifications, maximum))
+    # site indexes are 64-bit (module number in the upper half), so count them sparsely
+    locs = [{} for i in range(nClassifications)]
         
     c.execute("SELECT type FROM sites INNER JOIN injections ON sites.site = injections.site")
     types = c.fetchall()
@@ -186,7 +187,7 @@ def visClassifications(c, moreDetail=None):
                     ") to type ( Control-Branch )"
                 idx = 4
             typeBuckets[idx] += 1
-            locs[idx][site] += 1
+            locs[idx][site] = locs[idx].get(site, 0) + 1
             bits[idx][bit] += 1
         else:
             print "VIZ: not classified = ", i
@@ -385,7 +386,8 @@ def visCrashes(c):
     bits =  np.zeros((nClassifications, 64))
     c.execute("SELECT type FROM sites INNER JOIN injections ON sites.site = injections.site INNER JOIN trials ON trials.trial = injections.trial AND trials.crashed = 1")
     crash = c.fetchall()
-    crashed = float(len(crash))
+    c.execute("SELECT TOTAL(weight) FROM trials WHERE crashed = 1 AND numInj > 0")
+    crashed = c.fetchone()[0]
     c.execute("SELECT site, bit  FROM injections INNER JOIN trials ON injections.trial = trials.trial AND trials.crashed = 1")
     sitesBits = c.fetchall()
     for i in range(len(sitesBits)):
@@ -446,16 +448,16 @@ def visSignals(c):
     numSigs = 0.   
     sigs = {}
 
-    c.execute("SELECT DISTINCT trial, num FROM signals")
+    c.execute("SELECT DISTINCT signals.trial, num, weight FROM signals INNER JOIN trials ON trials.trial = signals.trial")
     #build histogram for what signals were raised
     signals =  c.fetchall()
     for pair in signals:
         s = pair[1]
-        numSigs += 1
+        numSigs += pair[2]
         if s in sigs:#  and s != 11:
-            sigs[s] += 1
+            sigs[s] += pair[2]
         else:
-            sigs[s] = 1.
+            sigs[s] = pair[2]
     
     fracs = [(numTrials - numSigs)/numTrialsInj]
     labels = ["No Signal"]
@@ -482,9 +484,9 @@ def visDetections(c, moreDetail=None):
     """
     #if moreDetail != None:
     #    print "TODO: implement more detail option for 'visDetections'"
-    c.execute("SELECT COUNT(trial) FROM trials WHERE detection = 1")
+    c.execute("SELECT TOTAL(weight) FROM trials WHERE detection = 1")
     detected = float(c.fetchone()[0])
-    c.execute("SELECT SUM(numInj) FROM trials")
+    c.execute("SELECT TOTAL(numInj*weight) FROM trials")
     numInj = float(c.fetchone()[0])
     
     piechart([detected/numInj, (numInj - detected)/numInj],\
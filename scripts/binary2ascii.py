@@ -16,6 +16,12 @@
 #
 #       e.g. binary2ascii.py foo.LLVM.bin -o bar.LLVM.txt
 #
+#       Given an executable or object file compiled with FlipIt it
+#       writes the site tables embedded in the binary instead, to
+#       foo.LLVM.txt for foo.
+#
+#       e.g. binary2ascii.py ./app -o app.LLVM.txt
+#
 #####################################################################
 
 import sys
@@ -40,4 +46,11 @@ if not os.path.isfile(infile):
     print ("File not found", infile)
     sys.exit(1)
 
-parseBinaryLogFile(None, infile, outfile)
+with open(infile, "rb") as f:
+    isELF = f.read(4) == b"\x7fELF"
+if isELF:
+    if parseBinarySiteTable(None, infile, outfile) == 0:
+        print ("No FlipIt site tables in", infile)
+        sys.exit(1)
+else:
+    parseBinaryLogFile(None, infile, outfile)
@@ -0,0 +1,778 @@
+#!/usr/bin/env python3
+#####################################################################
+#
+# This file is licensed under the University of Illinois/NCSA Open
+# Source License. See LICENSE.TXT for details.
+#
+#####################################################################
+
+#####################################################################
+#
+# Name: campaign.py
+#
+# Description: Adaptive fault injection campaign. Fault sites are
+#       split into strata by function and injection type. Each
+#       trial is restricted to the sites of one stratum with the
+#       runtime's fault site list (-nLOC/-fLOC). After every batch,
+#       the SDC, crash, and masked rates and their confidence
+#       intervals are recomputed for every stratum. A stratum stops
+#       being sampled once every interval is narrow enough, and the
+#       next batch goes to the strata that still need the most
+#       trials.
+#
+#       With mode = "importance" the sites are instead drawn from a
+#       dynamic execution profile flattened towards rarely executed
+#       sites, every trial injects into one execution of its site
+#       drawn uniformly (--plan), and carries the likelihood ratio that
+#       keeps the whole program estimate unbiased.
+#
+#       With mode = "classes" only the representative of every def-use
+#       equivalence class in the LLVM log files is injected into, and
+#       its rates stand for all the sites of its class.
+#
+#       With mode = "instances" every trial injects exactly one fault
+#       into one dynamic execution drawn uniformly from the profiled
+#       run, given to the runtime in a binary plan file (--plan).
+#
+#       Every trial is recorded in an append-only journal (journal.py);
+#       a campaign restarted with the same configuration and build
+#       takes the outcomes of finished trials from it and only runs
+#       the trials that had not finished.
+#
+#       Usage: python3 campaign.py [campaign_config.py directory]
+#
+#####################################################################
+import glob
+import math
+import os
+import random
+import re
+import sqlite3
+import subprocess
+import sys
+import time
+from concurrent.futures import Executor, Future, ThreadPoolExecutor
+from statistics import NormalDist
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "analysis"))
+from binaryParser import parseBinaryLogFile, parseBinarySiteTable
+from journal import Journal, buildHash
+from planfile import writePlan
+from crashrecord import readCrashRecords
+
+# campaign_config.py in the given (or current) directory wins over the default one
+sys.path.insert(0, os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else os.getcwd()))
+from campaign_config import *
+
+OUTCOMES = ("sdc", "crash", "masked")
+eventMessage = "FLIPIT_EVENT"
+siteMessage = "Successfully injected"
+trialJournal = None
+dispatcher = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "bin",
+                          "flipit-dispatch")
+
+
+class Stratum:
+    """Fault sites of one function and injection type and the outcomes of
+    the trials that were restricted to them."""
+
+    def __init__(self, function, type):
+        self.function = function
+        self.type = type
+        self.sites = []
+        self.counts = dict((o, 0) for o in OUTCOMES)
+        self.attempts = 0       # trials run, including those that never injected
+        self.unreached = False  # none of its sites executed in min_trials attempts
+        self.rep = None         # classes mode: the only site its trials inject into
+
+    def trials(self):
+        return sum(self.counts.values())
+
+    def add(self, outcome):
+        self.attempts += 1
+        if outcome in self.counts:
+            self.counts[outcome] += 1
+        elif self.attempts >= min_trials and self.trials() == 0:
+            self.unreached = True
+
+    def interval(self, outcome, z):
+        return wilson(self.counts[outcome], self.trials(), z)
+
+    def needed(self, z):
+        """Trials still needed before every interval is at most the target"""
+        n = self.trials()
+        if self.unreached:
+            return 0
+        if n < min_trials:
+            return min_trials - n
+        if max(self.interval(o, z)[1] for o in OUTCOMES) <= target_half_width:
+            return 0
+        if target_half_width <= 0:
+            return 1
+        # p(1-p) with the Wilson-adjusted rate so a rate of 0 or 1 does not stop sampling
+        adjusted = [(self.counts[o] + z*z/2) / (n + z*z) for o in OUTCOMES]
+        var = max(p*(1 - p) for p in adjusted)
+        return max(1, int(math.ceil(z*z*var / target_half_width**2)) - n)
+
+
+def wilson(x, n, z):
+    """Center and half-width of the Wilson score interval of x successes in n trials"""
+    if n == 0:
+        return 0., 1.
+    p = float(x) / n
+    denom = 1 + z*z/n
+    center = (p + z*z/(2*n)) / denom
+    half = z*math.sqrt(p*(1 - p)/n + z*z/(4*n*n)) / denom
+    return center, half
+
+
+def readLogs():
+    """Reads the site tables embedded in binary, or every LLVM log file under
+    LLVM_log_path if it has none, into the sites table of an in-memory
+    database"""
+    conn = sqlite3.connect(":memory:")
+    c = conn.cursor()
+    c.execute("CREATE TABLE sites (site int, type text, comment text, file text, function text, line int, opcode text, class int, classSize int, weight double)")
+    if binary is not None and parseBinarySiteTable(c, binary) > 0:
+        return conn
+    for path, subdirs, files in os.walk(LLVM_log_path):
+        for name in files:
+            if name.endswith("LLVM.bin"):
+                parseBinaryLogFile(c, os.path.join(path, name))
+    return conn
+
+
+def readSites():
+    """Returns the site, function, injection type, def-use class, and class
+    size of every fault site in the functions being sampled"""
+    conn = readLogs()
+    c = conn.cursor()
+    c.execute("SELECT site, function, type, class, classSize FROM sites ORDER BY site")
+    sites = [row for row in c.fetchall() if len(functions) == 0 or row[1] in functions]
+    conn.close()
+    return sites
+
+
+def readStrata(sites):
+    """Groups the fault sites by function and injection type"""
+    strata = {}
+    for site, function, type, cls, size in sites:
+        if (function, type) not in strata:
+            strata[(function, type)] = Stratum(function, type)
+        strata[(function, type)].sites.append(site)
+    return sorted(strata.values(), key=lambda s: (s.function, s.type))
+
+
+def readClasses(sites):
+    """Groups the fault sites by def-use class. A class takes the function
+    and injection type of its representative"""
+    classes = {}
+    for site, function, type, cls, size in sites:
+        if cls not in classes:
+            classes[cls] = Stratum(function, type)
+            classes[cls].rep = cls
+        if site == cls:
+            classes[cls].function, classes[cls].type = function, type
+        classes[cls].sites.append(site)
+    return [classes[cls] for cls in sorted(classes)]
+
+
+def allocate(strata, size, z):
+    """Splits a batch of trials over the strata in proportion to the
+    trials each still needs (largest remainder)"""
+    need = dict((s, s.needed(z)) for s in strata)
+    total = sum(need.values())
+    if total == 0:
+        return {}
+    size = min(size, total)
+    shares = dict((s, float(size) * need[s] / total) for s in strata if need[s] > 0)
+    alloc = dict((s, int(shares[s])) for s in shares)
+    left = size - sum(alloc.values())
+    for s in sorted(shares, key=lambda s: shares[s] - alloc[s], reverse=True)[:left]:
+        alloc[s] += 1
+    return dict((s, n) for s, n in alloc.items() if n > 0)
+
+
+def siteArgs(trial, sites):
+    """Runtime arguments of a trial restricted to the given fault sites"""
+    return "--seed %d -nLOC %d -fLOC %s" % (seed + trial, len(sites),
+                                           " ".join(str(s) for s in sites))
+
+
+def startTrial(trial, flipit, header=None):
+    """Output file and shell command of a trial, with the header line
+    written to the top of the file, or its outcome if the journal has the
+    trial as finished with the same arguments"""
+    if trialJournal is not None:
+        outcome = trialJournal.lookup(trial, flipit)
+        if outcome is not None:
+            return outcome, None, None
+        trialJournal.planned(trial, flipit)
+    args = flipit
+    if crash_records:
+        args += " --crashRecord " + crashPrefix(trial)
+    if "{flipit}" in command:
+        cmd = command.replace("{flipit}", args)
+    else:
+        cmd = command + " " + args
+
+    name = os.path.join(trial_path, "%s_%d.txt" % (trial_prefix, trial))
+    with open(name, "w") as out:
+        if header is not None:
+            out.write(header + "\n")
+    return None, name, cmd
+
+
+def finishTrial(trial, flipit, name, ret, seconds):
+    """Classifies a trial that ran; ret is None if it was killed after the
+    timeout"""
+    crashes = readCrashRecords(crashPrefix(trial)) if crash_records else []
+    if len(crashes) > 0:
+        # the analysis scripts find the crash in the trial's output
+        with open(name, "a") as out:
+            for r in crashes:
+                out.write("%s crash rank=%d inst=%d signal=%d addr=%#x pc=%#x site=%s "
+                          "since=%d injections=%d\n" %
+                          (eventMessage, r["rank"], r["executions"], r["signal"], r["addr"],
+                           r["pc"], r["lastSite"], r["sinceInjection"], r["injections"]))
+    if ret is None:
+        outcome = "crash"
+    else:
+        with open(name, errors="replace") as out:
+            outcome = classify(ret, out.read(), crashes)
+    if trialJournal is not None:
+        trialJournal.completed(trial, flipit, outcome, seconds)
+    return outcome
+
+
+def runTrial(trial, flipit, header=None):
+    """Runs one trial with the given runtime arguments and classifies it.
+    The header line is written to the top of the trial's output file. A
+    trial the journal has as finished with the same arguments is not run"""
+    outcome, name, cmd = startTrial(trial, flipit, header)
+    if outcome is not None:
+        return outcome
+
+    start = time.time()
+    with open(name, "a") as out:
+        try:
+            ret = subprocess.call(cmd, shell=True, stdout=out, stderr=subprocess.STDOUT,
+                                  timeout=timeout)
+        except subprocess.TimeoutExpired:
+            out.write("\nFlipIt campaign: trial killed after %s seconds\n" % timeout)
+            ret = None
+    return finishTrial(trial, flipit, name, ret, time.time() - start)
+
+
+class DispatchFuture(Future):
+    """Outcome of a trial of a DispatchPool; asking for it runs every trial
+    submitted so far"""
+    def __init__(self, pool):
+        Future.__init__(self)
+        self.pool = pool
+
+    def result(self, timeout=None):
+        self.pool.flush()
+        return Future.result(self, timeout)
+
+
+class DispatchPool(Executor):
+    """Runs the trials of a batch as one MPI job of flipit-dispatch
+    (src/campaign/dispatch.c): rank 0 hands the trials out one at a time to
+    the other ranks, which run them where they are. Only runTrial can be
+    submitted"""
+    def __init__(self):
+        self.pending = []
+        self.batch = 0
+
+    def submit(self, fn, trial, flipit, header=None):
+        future = DispatchFuture(self)
+        outcome, name, cmd = startTrial(trial, flipit, header)
+        if outcome is not None:
+            future.set_result(outcome)
+        else:
+            self.pending.append((future, trial, flipit, name, cmd))
+        return future
+
+    def flush(self):
+        if len(self.pending) == 0:
+            return
+        pending = self.pending
+        self.pending = []
+        tasks = os.path.join(trial_path, "dispatch_%d.tasks" % self.batch)
+        results = os.path.join(trial_path, "dispatch_%d.results" % self.batch)
+        self.batch += 1
+        with open(tasks, "w") as f:
+            for future, trial, flipit, name, cmd in pending:
+                f.write("%d\t%s\t%s\n" % (trial, os.path.abspath(name), cmd.replace("\n", " ")))
+        if os.path.exists(results):
+            os.remove(results)
+        subprocess.call("%s %s %s %s -t %s" % (distributed, dispatcher, tasks, results,
+                                                timeout if timeout is not None else 0),
+                        shell=True)
+
+        records = {}
+        if os.path.exists(results):
+            for line in open(results):
+                fields = dict(f.split("=", 1) for f in line.split() if "=" in f)
+                records[int(fields["trial"])] = fields
+        for future, trial, flipit, name, cmd in pending:
+            r = records.get(trial)
+            if r is None:
+                # the journal keeps the trials that did not finish in flight
+                raise RuntimeError("flipit-dispatch did not finish trial %d; run the campaign "
+                                   "again to resume it" % trial)
+            ret = None if r["timeout"] == "1" else \
+                (int(r["status"]) if r["status"] != "-1" else -int(r["signal"]))
+            future.set_result(finishTrial(trial, flipit, name, ret, float(r["seconds"])))
+        os.remove(tasks)
+        os.remove(results)
+
+
+def trialPool():
+    """Where the trials of a batch run: jobs local processes, or an MPI job"""
+    if distributed is not None:
+        return DispatchPool()
+    return ThreadPoolExecutor(max_workers=jobs)
+
+
+def crashPrefix(trial):
+    """--crashRecord name of a trial; the runtime appends _<rank>"""
+    return os.path.join(trial_path, "%s_%d.crash" % (trial_prefix, trial))
+
+
+def classify(ret, output, crashes=()):
+    """crash, sdc, masked, or none if no fault was injected. crashes are
+    the trial's crash records, which count even if the output was lost"""
+    injected = output.count(siteMessage) + sum(r["injections"] for r in crashes)
+    crashed = ret != 0 or len(crashes) > 0
+    sdc = False
+    for line in output.splitlines():
+        if not line.startswith(eventMessage + " trial "):
+            continue
+        fields = dict(f.split("=", 1) for f in line.split()[2:] if "=" in f)
+        injected += int(fields.get("injections", 0))
+        crashed = crashed or fields.get("outcome") == "crashed"
+        sdc = sdc or int(fields.get("mismatches", 0)) > 0
+    if crash_pattern and re.search(crash_pattern, output):
+        crashed = True
+    if sdc_pattern and re.search(sdc_pattern, output):
+        sdc = True
+
+    if injected == 0 and not crashed:
+        return "none"
+    if crashed:
+        return "crash"
+    return "sdc" if sdc else "masked"
+
+
+def pooled(strata, outcome, z):
+    """Stratified estimate over a group of strata, each weighted by its
+    number of static fault sites"""
+    strata = [s for s in strata if s.trials() > 0]
+    sites = float(sum(len(s.sites) for s in strata))
+    if sites == 0:
+        return 0., 1.
+    rate = var = 0.
+    for s in strata:
+        w = len(s.sites) / sites
+        p = float(s.counts[outcome]) / s.trials()
+        rate += w*p
+        var += w*w*p*(1 - p) / s.trials()
+    return rate, z*math.sqrt(var)
+
+
+def writeResults(strata, z):
+    rows = []
+    for s in strata:
+        status = "unreached" if s.unreached else ("done" if s.needed(z) == 0 else "sampling")
+        row = [s.function, s.type, len(s.sites), s.attempts, s.trials()]
+        row += [s.counts[o] for o in OUTCOMES]
+        for o in OUTCOMES:
+            row += [float(s.counts[o]) / s.trials() if s.trials() else 0., s.interval(o, z)[1]]
+        rows.append(row + [status])
+
+    # marginals by function and by injection type
+    groups = {}
+    for s in strata:
+        groups.setdefault((s.function, "*"), []).append(s)
+        groups.setdefault(("*", s.type), []).append(s)
+        groups.setdefault(("*", "*"), []).append(s)
+    for key in sorted(groups):
+        g = groups[key]
+        row = [key[0], key[1], sum(len(s.sites) for s in g), sum(s.attempts for s in g),
+               sum(s.trials() for s in g)]
+        row += [sum(s.counts[o] for s in g) for o in OUTCOMES]
+        for o in OUTCOMES:
+            row += list(pooled(g, o, z))
+        rows.append(row + ["pooled"])
+
+    with open(results, "w") as f:
+        f.write("function,type,sites,attempts,trials,sdc,crash,masked,"
+                "sdc_rate,sdc_half_width,crash_rate,crash_half_width,"
+                "masked_rate,masked_half_width,status\n")
+        for row in rows:
+            f.write(",".join("%.6f" % v if isinstance(v, float) else str(v) for v in row) + "\n")
+
+
+def writeClassResults(classes, z):
+    """One row per class, then the rates of every function, injection type,
+    and the whole program extrapolated from the classes that were reached,
+    each weighted by its number of sites"""
+    rows = []
+    for k in classes:
+        status = "unreached" if k.unreached else ("done" if k.attempts >= class_trials else "sampling")
+        row = [k.function, k.type, k.rep, len(k.sites), k.attempts, k.trials()]
+        row += [k.counts[o] for o in OUTCOMES]
+        for o in OUTCOMES:
+            row += [float(k.counts[o]) / k.trials() if k.trials() else 0., k.interval(o, z)[1]]
+        rows.append(row + [status])
+
+    groups = {}
+    for k in classes:
+        groups.setdefault((k.function, "*"), []).append(k)
+        groups.setdefault(("*", k.type), []).append(k)
+        groups.setdefault(("*", "*"), []).append(k)
+    for key in sorted(groups):
+        g = groups[key]
+        row = [key[0], key[1], "*", sum(len(k.sites) for k in g), sum(k.attempts for k in g),
+               sum(k.trials() for k in g)]
+        row += [sum(k.counts[o] for k in g) for o in OUTCOMES]
+        for o in OUTCOMES:
+            row += list(pooled(g, o, z))
+        rows.append(row + ["extrapolated"])
+
+    with open(results, "w") as f:
+        f.write("function,type,class,sites,attempts,trials,sdc,crash,masked,"
+                "sdc_rate,sdc_half_width,crash_rate,crash_half_width,"
+                "masked_rate,masked_half_width,status\n")
+        for row in rows:
+            f.write(",".join("%.6f" % v if isinstance(v, float) else str(v) for v in row) + "\n")
+
+
+def classCampaign(classes, z):
+    """Runs class_trials trials on the representative of every class"""
+    sites = sum(len(k.sites) for k in classes)
+    print("Campaign over %d def-use classes of %d fault sites (%.1fx fewer)" %
+          (len(classes), sites, float(sites) / len(classes)))
+    trial = 0
+    with trialPool() as pool:
+        while trial < max_trials:
+            pending = [k for k in classes if k.attempts < class_trials and not k.unreached]
+            if len(pending) == 0:
+                break
+            futures = []
+            size = min(batch_size, max_trials - trial)
+            for k in pending:
+                for i in range(min(class_trials - k.attempts, size - len(futures))):
+                    futures.append((k, pool.submit(runTrial, trial, siteArgs(trial, [k.rep]))))
+                    trial += 1
+            for k, f in futures:
+                k.add(f.result())
+                if k.attempts >= class_trials and k.trials() == 0:
+                    k.unreached = True
+            writeClassResults(classes, z)
+            print("trials %d: %d of %d classes still sampling" % (trial, len(pending), len(classes)))
+
+    reached = [k for k in classes if k.trials() > 0]
+    print("%d classes reached, standing for %d fault sites" %
+          (len(reached), sum(len(k.sites) for k in reached)))
+    print("Whole program: " + " ".join("%s=%.3f+-%.3f" % ((o,) + pooled(classes, o, z))
+                                       for o in OUTCOMES))
+    print("Rates written to " + results)
+
+
+def readProfile(byRank=False):
+    """Dynamic executions of every fault site summed over the histogram
+    files of all ranks (FLIPIT_Finalize of libcorrupt_histo). With byRank
+    the keys are (rank, site), the rank taken from the file name's _<rank>.
+    With profile = "static" and no byRank, the pass's static estimate of
+    the executions of every site per invocation of its function"""
+    if profile == "static" and not byRank:
+        conn = readLogs()
+        c = conn.cursor()
+        c.execute("SELECT site, weight FROM sites WHERE weight > 0")
+        counts = dict(c.fetchall())
+        conn.close()
+        return counts
+    counts = {}
+    for name in glob.glob(profile):
+        rank = int(name.rsplit("_", 1)[1]) if byRank else None
+        for line in open(name):
+            split = line.split()
+            if len(split) == 3 and split[0] == "Location" and split[1] != "other:":
+                key = int(split[1][0:-1])
+                if byRank:
+                    key = (rank, key)
+                counts[key] = counts.get(key, 0) + int(split[2])
+    return counts
+
+
+def buildPlan(strata, counts, rankCounts=None):
+    """Draws the fault site of every trial. A fault hits a site in proportion
+    to how often it executes (p). Sites are drawn from q, which flattens p
+    with importance_alpha and mixes p back in with importance_mix so no
+    weight p/q grows without bound. With the counts of every rank, each
+    trial's fault then goes into one execution of its site drawn uniformly
+    from all ranks, written as a plan entry (trial, rank, 0, site, instance,
+    bit); without them the plan is empty"""
+    sites = [(site, s) for s in strata for site in s.sites if counts.get(site, 0) > 0]
+    total = float(sum(counts[site] for site, s in sites))
+    flat = float(sum(counts[site]**importance_alpha for site, s in sites))
+    plan = []
+    for site, s in sites:
+        p = counts[site] / total
+        q = (1 - importance_mix)*counts[site]**importance_alpha/flat + importance_mix*p
+        plan.append((site, s, p, q))
+    if len(plan) == 0:
+        return [], {}, []
+
+    rng = random.Random(seed)
+    draws = rng.choices(plan, weights=[q for site, s, p, q in plan], k=max_trials)
+    with open(plan_file, "w") as f:
+        f.write("trial,site,function,type,p,q,weight\n")
+        for trial, (site, s, p, q) in enumerate(draws):
+            f.write("%d,%d,%s,%s,%e,%e,%e\n" % (trial, site, s.function, s.type, p, q, p/q))
+
+    instances = []
+    if rankCounts is not None:
+        ranks = {}
+        for rank, site in rankCounts:
+            if rankCounts[(rank, site)] > 0:
+                ranks.setdefault(site, []).append(rank)
+        for trial, (site, s, p, q) in enumerate(draws):
+            weights = [rankCounts[(r, site)] for r in ranks[site]]
+            rank = rng.choices(ranks[site], weights=weights)[0]
+            instances.append((trial, rank, 0, site, rng.randint(1, rankCounts[(rank, site)]),
+                              rng.randrange(64)))
+    return draws, dict((s, sum(p for site, t, p, q in plan if t == s)) for s in strata), instances
+
+
+def weighted(trials, outcome, z):
+    """Self-normalized importance sampling estimate of an outcome rate and
+    the half-width of its confidence interval"""
+    sw = sum(w for w, o in trials)
+    if sw == 0:
+        return 0., 1.
+    rate = sum(w for w, o in trials if o == outcome) / sw
+    var = sum(w*w*((o == outcome) - rate)**2 for w, o in trials) / (sw*sw)
+    return rate, z*math.sqrt(var)
+
+
+def writeWeightedResults(groups, shares, z):
+    """One row per function, injection type, and the whole program. share is
+    the fraction of faults that land in the group"""
+    with open(results, "w") as f:
+        f.write("function,type,share,trials,effective_trials,sdc_rate,sdc_half_width,"
+                "crash_rate,crash_half_width,masked_rate,masked_half_width\n")
+        for key in sorted(groups):
+            trials = groups[key]
+            sw = sum(w for w, o in trials)
+            sw2 = sum(w*w for w, o in trials)
+            row = [key[0], key[1], shares.get(key, 0.), len(trials), sw*sw/sw2 if sw2 else 0.]
+            for o in OUTCOMES:
+                row += list(weighted(trials, o, z))
+            f.write(",".join("%.6f" % v if isinstance(v, float) else str(v) for v in row) + "\n")
+
+
+def importanceCampaign(strata, z):
+    """Trials draw their site from q and carry the weight p/q. With a
+    histogram profile every trial injects into one execution of its site
+    drawn uniformly (--plan), like instances mode, so the weight is the
+    likelihood ratio of the fault itself. With profile = "static" the
+    executions are not known and the trial is only restricted to its site"""
+    rankCounts = None
+    if profile == "static":
+        counts = readProfile()
+    else:
+        rankCounts = readProfile(byRank=True)
+        counts = {}
+        for (rank, site), n in rankCounts.items():
+            counts[site] = counts.get(site, 0) + n
+    if len(counts) == 0:
+        print("No executed fault sites in the profile " + profile)
+        return
+    draws, stratumShares, instances = buildPlan(strata, counts, rankCounts)
+    if len(draws) == 0:
+        print("None of the fault sites in the profile " + profile + " are being sampled")
+        return
+    if len(instances) > 0:
+        writePlan(instance_plan, instances)
+    shares = {}
+    for s, share in stratumShares.items():
+        for key in ((s.function, "*"), ("*", s.type), ("*", "*")):
+            shares[key] = shares.get(key, 0.) + share
+    print("Importance sampling plan of %d trials over %d executed fault sites" %
+          (len(draws), len(set(site for site, s, p, q in draws))))
+
+    groups = {}
+    trial = 0
+    with trialPool() as pool:
+        while trial < len(draws):
+            batch = draws[trial:trial + batch_size]
+            futures = []
+            for site, s, p, q in batch:
+                header = "%s plan rank=-1 inst=0 site=%d p=%e q=%e weight=%e" % \
+                    (eventMessage, site, p, q, p/q)
+                if len(instances) > 0:
+                    flipit = "--plan %s --planTrial %d" % (os.path.abspath(instance_plan), trial)
+                else:
+                    flipit = siteArgs(trial, [site])
+                futures.append((s, p/q, pool.submit(runTrial, trial, flipit, header)))
+                trial += 1
+            for s, w, f in futures:
+                outcome = f.result()
+                if outcome not in OUTCOMES:
+                    continue
+                for key in ((s.function, "*"), ("*", s.type), ("*", "*")):
+                    groups.setdefault(key, []).append((w, outcome))
+            writeWeightedResults(groups, shares, z)
+
+            overall = groups.get(("*", "*"), [])
+            widths = [weighted(overall, o, z)[1] for o in OUTCOMES]
+            print("trials %d: whole program half-width %.4f" % (trial, max(widths)))
+            if len(overall) >= min_trials and max(widths) <= target_half_width:
+                break
+
+    overall = groups.get(("*", "*"), [])
+    print("Whole program: " + " ".join("%s=%.3f+-%.3f" % ((o,) + weighted(overall, o, z))
+                                       for o in OUTCOMES))
+    print("Rates written to " + results)
+
+
+def instanceCampaign(strata, z):
+    """Every trial flips one bit of one dynamic execution, drawn uniformly
+    from all the executions of the profiled run: a rank and site in
+    proportion to its count, then which of its executions. Every trial has
+    the weight of a real fault"""
+    counts = readProfile(byRank=True)
+    stratum = dict((site, s) for s in strata for site in s.sites)
+    keys = [k for k in counts if counts[k] > 0 and k[1] in stratum]
+    if len(keys) == 0:
+        print("No executed fault sites in the profile " + profile)
+        return
+
+    rng = random.Random(seed)
+    draws = rng.choices(keys, weights=[counts[k] for k in keys], k=max_trials)
+    plan = [(trial, rank, 0, site, rng.randint(1, counts[(rank, site)]), rng.randrange(64))
+            for trial, (rank, site) in enumerate(draws)]
+    writePlan(instance_plan, plan)
+    print("Plan of %d exact injections over %d executions of %d fault sites written to %s" %
+          (len(plan), sum(counts[k] for k in keys), len(set(site for rank, site in keys)),
+           instance_plan))
+
+    groups = {}
+    shares = {}
+    total = float(sum(counts[k] for k in keys))
+    for rank, site in keys:
+        s = stratum[site]
+        for key in ((s.function, "*"), ("*", s.type), ("*", "*")):
+            shares[key] = shares.get(key, 0.) + counts[(rank, site)] / total
+    trial = 0
+    with trialPool() as pool:
+        while trial < len(plan):
+            futures = []
+            for t, rank, thread, site, instance, bit in plan[trial:trial + batch_size]:
+                header = "%s instance rank=%d inst=0 site=%d instance=%d bit=%d" % \
+                    (eventMessage, rank, site, instance, bit)
+                flipit = "--plan %s --planTrial %d" % (os.path.abspath(instance_plan), t)
+                futures.append((stratum[site], pool.submit(runTrial, t, flipit, header)))
+                trial += 1
+            for s, f in futures:
+                outcome = f.result()
+                if outcome not in OUTCOMES:
+                    continue
+                for key in ((s.function, "*"), ("*", s.type), ("*", "*")):
+                    groups.setdefault(key, []).append((1., outcome))
+            writeWeightedResults(groups, shares, z)
+
+            overall = groups.get(("*", "*"), [])
+            widths = [weighted(overall, o, z)[1] for o in OUTCOMES]
+            print("trials %d: whole program half-width %.4f" % (trial, max(widths)))
+            if len(overall) >= min_trials and max(widths) <= target_half_width:
+                break
+
+    overall = groups.get(("*", "*"), [])
+    print("Whole program: " + " ".join("%s=%.3f+-%.3f" % ((o,) + weighted(overall, o, z))
+                                       for o in OUTCOMES))
+    print("Rates written to " + results)
+
+
+def openJournal():
+    """Opens the journal, keyed by the hash of the build (binary, or the
+    LLVM log files the campaign samples from)"""
+    global trialJournal
+    if journal is None:
+        return
+    if binary is not None:
+        names = [binary]
+    else:
+        names = [os.path.join(path, name) for path, subdirs, files in os.walk(LLVM_log_path)
+                 for name in files if name.endswith("LLVM.bin")]
+    trialJournal = Journal(journal, buildHash(names))
+    if len(trialJournal.done) > 0 or trialJournal.inFlight > 0:
+        print("Resuming from %s: %d finished trials, %d in flight run again" %
+              (journal, len(trialJournal.done), trialJournal.inFlight))
+    if trialJournal.stale > 0:
+        print("Warning: %d finished trials in %s are of another build and run again" %
+              (trialJournal.stale, journal))
+
+
+def campaign():
+    z = NormalDist().inv_cdf(0.5 + confidence/2)
+    sites = readSites()
+    if len(sites) == 0:
+        print("No fault sites found in " + LLVM_log_path)
+        return
+    if not os.path.isdir(trial_path):
+        os.makedirs(trial_path)
+    openJournal()
+    try:
+        sample(sites, z)
+    finally:
+        if trialJournal is not None:
+            trialJournal.close()
+
+
+def sample(sites, z):
+    if mode == "classes":
+        classCampaign(readClasses(sites), z)
+        return
+    strata = readStrata(sites)
+    if mode == "importance":
+        importanceCampaign(strata, z)
+        return
+    if mode == "instances":
+        instanceCampaign(strata, z)
+        return
+
+    print("Campaign over %d strata, %d fault sites" % (len(strata),
+                                                       sum(len(s.sites) for s in strata)))
+    trial = 0
+    with trialPool() as pool:
+        while trial < max_trials:
+            alloc = allocate(strata, min(batch_size, max_trials - trial), z)
+            if len(alloc) == 0:
+                break
+            futures = []
+            for s in sorted(alloc, key=lambda s: (s.function, s.type)):
+                for i in range(alloc[s]):
+                    futures.append((s, pool.submit(runTrial, trial, siteArgs(trial, s.sites))))
+                    trial += 1
+            for s, f in futures:
+                s.add(f.result())
+            writeResults(strata, z)
+
+            active = [s for s in strata if s.needed(z) > 0]
+            print("trials %d: %d of %d strata still sampling" % (trial, len(active), len(strata)))
+
+    for s in strata:
+        print("%-30s %-15s n=%-6d" % (s.function, s.type, s.trials()) +
+              " ".join("%s=%.3f+-%.3f" % ((o,) + (float(s.counts[o]) / max(s.trials(), 1),
+                                                   s.interval(o, z)[1])) for o in OUTCOMES) +
+              (" unreached" if s.unreached else ""))
+    print("Rates written to " + results)
+
+
+if __name__ == "__main__":
+    campaign()
@@ -0,0 +1,143 @@
+"""Command that runs one fault injection trial of the application. FlipIt's
+    runtime arguments (seed, fault site list) are put where '{flipit}'
+    appears, or appended to the end of the command if it does not appear.
+
+    Notes
+    -----
+    e.g. "mpirun -n 4 ./jacobi {flipit} --numberFaulty 1 --faulty 3"
+"""
+command = "./short"
+
+"""How fault sites are chosen: "stratified" samples every function and
+    injection type until its rates are known to target_half_width,
+    "importance" draws sites from the dynamic execution profile below,
+    "classes" only injects into one representative site of every def-use
+    equivalence class the FlipIt pass found, and "instances" injects every
+    trial's fault into one exact dynamic execution drawn from the profile.
+"""
+mode = "stratified"
+
+"""Path to where the LLVM log files, (*.LLVM.bin), generated by FlipIt exist.
+    Every fault site in them belongs to one stratum: the function it is in
+    and its injection type (Arith, Pointer, Control-Loop, ...).
+"""
+LLVM_log_path = "."
+
+"""Only sample strata of these functions. An empty list samples them all.
+"""
+functions = []
+
+"""Where the output of every trial is written, as trial_prefix_#.txt so the
+    scripts in ../analysis can read them as well.
+"""
+trial_path = "trials"
+trial_prefix = "trial"
+
+"""Target half-width of the confidence interval of every outcome rate
+    (SDC, crash, masked) in every stratum, and the confidence level.
+    A stratum stops being sampled once all three are at or below the target.
+"""
+target_half_width = 0.05
+confidence = 0.95
+
+"""Trials every stratum receives before its interval is trusted, the trials
+    run between two reallocations, and the most trials of the campaign.
+"""
+min_trials = 20
+batch_size = 64
+max_trials = 10000
+
+"""Number of trials that run at the same time and the seconds after which a
+    trial is killed and counted as a crash (hang). None waits forever.
+"""
+jobs = 4
+timeout = 600
+
+"""Runs every batch of trials as one MPI job instead: this launcher starts
+    flipit-dispatch (built by library.sh into bin/), whose rank 0 hands the
+    trials out one at a time to the other ranks, each running one trial at
+    a time where it is placed. jobs is then ignored.
+
+    Notes
+    -----
+    e.g. distributed = "mpirun -n 8" runs 7 trials at a time. The trial's
+    command must not rely on the MPI environment of the job; flipit-dispatch
+    removes it, so a trial can be an mpirun of its own.
+"""
+distributed = None
+
+"""Seed of the first trial; trial # uses seed + #.
+"""
+seed = 533
+
+"""A trial whose output matches sdc_pattern (regular expression) is an SDC,
+    as is one whose FLIPIT_EVENT trial record has mismatches > 0 (see
+    FLIPIT_CompareBuffers). A trial that exits with a nonzero status, is
+    killed by a signal, or prints crash_pattern is a crash.
+"""
+sdc_pattern = None
+crash_pattern = "Assertion|Sig 11|exit signal"
+
+"""Histogram files (FLIPIT_Finalize of an application linked with
+    libcorrupt_histo; a glob to sum all ranks) used in importance mode.
+
+    Notes
+    -----
+    A fault lands on a site in proportion to how often the site executes (p).
+    Sites are drawn from q = (1 - mix) * count^alpha / sum + mix * p instead:
+    alpha = 1 samples like a real fault, alpha = 0 samples every executed site
+    equally. Each trial records its weight p/q, and the estimates use the
+    weights, so they still describe real faults. The fault of every trial
+    goes into one execution of its site drawn uniformly from all ranks, given
+    to the runtime in instance_plan.
+
+    profile = "static" uses the weights the FlipIt pass writes into the LLVM
+    log files instead of a profiling run: its estimate of how often every
+    site executes per call of its function, from static branch probabilities
+    and known loop trip counts. Only as good as that estimate, and it does
+    not know how often each function is called, nor which executions to
+    plan, so the trials are only restricted to their site (-fLOC). Instances
+    mode needs the histograms.
+"""
+profile = "histogram_*"
+importance_alpha = 0.5
+importance_mix = 0.1
+
+"""Trials run on the representative of every def-use class in classes mode.
+    A class none of whose trials injected a fault is unreached and left out
+    of the extrapolated rates.
+"""
+class_trials = 10
+
+"""Binary plan file of instances and importance mode (see planfile.py).
+    Every trial runs with "--plan <file> --planTrial <trial>" and flips the
+    planned bit of the planned execution of its site on its rank, without
+    drawing any random numbers. The profile has to come from a run with the same inputs and
+    number of ranks.
+"""
+instance_plan = "campaign_plan.bin"
+
+"""Have the runtime write a binary crash record per crashing rank
+    (--crashRecord <trial_path>/<trial_prefix>_<trial>.crash, read by
+    crashrecord.py). A crash is then found even if the trial's output was
+    lost, and the crashing rank's signal, address, and last injected site
+    go into its output as a FLIPIT_EVENT crash line.
+"""
+crash_records = True
+
+"""Journal of every trial that was started and finished (see journal.py),
+    and the instrumented executable whose hash goes into every record. A
+    campaign restarted with the same configuration takes the outcomes of
+    finished trials of the same build from the journal and only runs the
+    others again. None as binary hashes the LLVM log files instead; None as
+    journal keeps no journal. The fault sites are read from the site tables
+    embedded in binary if it has them, and LLVM_log_path is not used.
+"""
+journal = "campaign_journal.log"
+binary = None
+
+"""Rates are written here after every batch, and the importance sampling
+    plan (site, p, q, and weight of every trial) to plan_file.
+"""
+results = "campaign_rates.csv"
+plan_file = "campaign_plan.csv"
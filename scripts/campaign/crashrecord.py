@@ -0,0 +1,68 @@
+#####################################################################
+#
+# This file is licensed under the University of Illinois/NCSA Open
+# Source License. See LICENSE.TXT for details.
+#
+#####################################################################
+
+#####################################################################
+#
+# Name: crashrecord.py
+#
+# Description: Reads the binary crash records the runtime writes
+#       with --crashRecord <name> (FLIPIT_CrashRecord in corrupt.h)
+#       to <name>_<rank> when a rank dies of a fatal signal. A rank
+#       that did not crash leaves no file, or an empty one if it
+#       never reached FLIPIT_Finalize.
+#
+#       python3 crashrecord.py <record> [<record> ...]
+#
+#####################################################################
+import glob
+import struct
+import sys
+
+MAGIC = 0x4853415243544946      # "FITCRASH"
+NO_SITE = 2**64 - 1
+FRAMES = 16
+
+RECORD = struct.Struct("=QIIiiQQQQQQII%dQ" % FRAMES)
+FIELDS = ("magic", "version", "rank", "signal", "code", "addr", "pc", "lastSite",
+          "injections", "executions", "sinceInjection", "frames", "reserved")
+
+
+def readCrashRecord(name):
+    """The record in a file as a dict, with the backtrace in 'frame' and
+    lastSite None if nothing was injected, or None if there is none"""
+    with open(name, "rb") as f:
+        data = f.read(RECORD.size)
+    if len(data) < RECORD.size:
+        return None
+    values = RECORD.unpack(data)
+    record = dict(zip(FIELDS, values))
+    if record["magic"] != MAGIC:
+        raise ValueError("%s is not a FlipIt crash record" % name)
+    record["frame"] = list(values[len(FIELDS):len(FIELDS) + record["frames"]])
+    if record["lastSite"] == NO_SITE:
+        record["lastSite"] = None
+    return record
+
+
+def readCrashRecords(prefix):
+    """The records of every rank of a run started with --crashRecord
+    <prefix>, sorted by rank"""
+    records = [readCrashRecord(name) for name in glob.glob(glob.escape(prefix) + "_*")]
+    return sorted((r for r in records if r is not None), key=lambda r: r["rank"])
+
+
+if __name__ == "__main__":
+    for name in sys.argv[1:]:
+        r = readCrashRecord(name)
+        if r is None:
+            print("%s: no crash" % name)
+            continue
+        print("%s: rank %d signal %d (code %d) at %#x, pc %#x" %
+              (name, r["rank"], r["signal"], r["code"], r["addr"], r["pc"]))
+        print("    last injected site %s, %d site executions after it, %d injections" %
+              (r["lastSite"], r["sinceInjection"], r["injections"]))
+        print("    backtrace " + " ".join("%#x" % f for f in r["frame"]))
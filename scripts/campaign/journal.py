@@ -0,0 +1,128 @@
+#####################################################################
+#
+# This file is licensed under the University of Illinois/NCSA Open
+# Source License. See LICENSE.TXT for details.
+#
+#####################################################################
+
+#####################################################################
+#
+# Name: journal.py
+#
+# Description: Append-only journal of the trials of a campaign, so a
+#       campaign that is killed can be restarted without running
+#       any finished trial again. Every trial writes two lines
+#
+#           planned trial=<#> hash=<h> args=<runtime arguments>
+#           completed trial=<#> outcome=<o> seconds=<s> hash=<h> args=<...>
+#
+#       when it starts and when it ends. args (seed and fault sites,
+#       or plan file and trial) come last and run to the end of the
+#       line; hash identifies the instrumented build. Every line is
+#       flushed as it is written and synced to disk (fsync) in
+#       batches, so a node crash loses at most the last few completed
+#       trials, which simply run again. A torn last line is ignored.
+#
+#####################################################################
+import hashlib
+import os
+import threading
+import time
+
+
+def buildHash(names):
+    """sha1 of the contents of the given files, in sorted order"""
+    h = hashlib.sha1()
+    for name in sorted(names):
+        with open(name, "rb") as f:
+            for block in iter(lambda: f.read(1 << 20), b""):
+                h.update(block)
+    return h.hexdigest()[0:16]
+
+
+def parseLine(line):
+    """(record, fields) of one journal line, or None if it is torn"""
+    if not line.endswith("\n") or " args=" not in line:
+        return None
+    head, args = line[0:-1].split(" args=", 1)
+    split = head.split()
+    try:
+        fields = dict(f.split("=", 1) for f in split[1:])
+        fields["trial"] = int(fields["trial"])
+    except (ValueError, KeyError):
+        return None
+    fields["args"] = args
+    return split[0], fields
+
+
+class Journal:
+    """Finished trials of earlier runs of the campaign and the journal the
+    trials of this run are appended to"""
+    def __init__(self, name, hash, syncEvery=16, syncSeconds=5.):
+        self.name = name
+        self.hash = hash
+        self.syncEvery = syncEvery
+        self.syncSeconds = syncSeconds
+        self.lock = threading.Lock()
+        self.done = {}
+        self.stale = 0
+        planned = set()
+        if os.path.isfile(name):
+            with open(name) as f:
+                for line in f:
+                    record = parseLine(line)
+                    if record is None:
+                        continue
+                    kind, fields = record
+                    key = (fields["trial"], fields["args"])
+                    if kind == "planned":
+                        planned.add(key)
+                    elif kind == "completed" and fields.get("hash") != hash:
+                        self.stale += 1
+                    elif kind == "completed":
+                        self.done[key] = fields["outcome"]
+        self.inFlight = len(planned - set(self.done))
+        self.file = open(name, "a")
+        # end a torn last line so the next record starts on a line of its own
+        if self.file.tell() > 0:
+            with open(name, "rb") as f:
+                f.seek(-1, os.SEEK_END)
+                if f.read(1) != b"\n":
+                    self.file.write("\n")
+        self.unsynced = 0
+        self.lastSync = time.time()
+
+    def lookup(self, trial, args):
+        """Outcome of the trial if it already finished with these arguments"""
+        return self.done.get((trial, args))
+
+    def planned(self, trial, args):
+        self.write("planned trial=%d hash=%s args=%s\n" % (trial, self.hash, args))
+
+    def completed(self, trial, args, outcome, seconds):
+        self.write("completed trial=%d outcome=%s seconds=%.3f hash=%s args=%s\n" %
+                   (trial, outcome, seconds, self.hash, args))
+
+    def write(self, line):
+        with self.lock:
+            # a killed campaign loses nothing once the line is flushed; fsync only
+            # matters if the node goes down, so it is batched
+            self.file.write(line)
+            self.file.flush()
+            self.unsynced += 1
+            if self.unsynced >= self.syncEvery or time.time() - self.lastSync >= self.syncSeconds:
+                self.syncLocked()
+
+    def sync(self):
+        with self.lock:
+            self.syncLocked()
+
+    def syncLocked(self):
+        self.file.flush()
+        os.fsync(self.file.fileno())
+        self.unsynced = 0
+        self.lastSync = time.time()
+
+    def close(self):
+        self.sync()
+        self.file.close()
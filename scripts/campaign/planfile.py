@@ -0,0 +1,45 @@
+#####################################################################
+#
+# This file is licensed under the University of Illinois/NCSA Open
+# Source License. See LICENSE.TXT for details.
+#
+#####################################################################
+
+#####################################################################
+#
+# Name: planfile.py
+#
+# Description: Reads and writes the binary campaign plan files the
+#       runtime maps with --plan (FLIPIT_PlanHeader and
+#       FLIPIT_PlanEntry in corrupt.h). Every entry names one fault:
+#       the trial, rank, and thread it belongs to, the site, which
+#       execution of the site (counting from 1), and the bit to flip.
+#
+#####################################################################
+import struct
+
+MAGIC = 0x314e414c50544946      # "FITPLAN1"
+ANY_SITE = 2**64 - 1
+ANY_THREAD = 2**32 - 1
+
+HEADER = struct.Struct("=QQ")
+ENTRY = struct.Struct("=QIIQQII")
+
+
+def writePlan(name, entries):
+    """entries are (trial, rank, thread, site, instance, bit) tuples.
+    The runtime looks trials up by binary search, so they are sorted"""
+    entries = sorted(entries, key=lambda e: e[0])
+    with open(name, "wb") as f:
+        f.write(HEADER.pack(MAGIC, len(entries)))
+        for trial, rank, thread, site, instance, bit in entries:
+            f.write(ENTRY.pack(trial, rank, thread, site, instance, bit, 0))
+
+
+def readPlan(name):
+    with open(name, "rb") as f:
+        data = f.read()
+    magic, count = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("%s is not a FlipIt plan file" % name)
+    return [ENTRY.unpack_from(data, HEADER.size + i*ENTRY.size)[0:6] for i in range(count)]
@@ -32,6 +32,27 @@ BUILD_TYPE = "Debug+Asserts"
 #    ctrl - add code to inject into control (0 or 1)
 #    stateFile - unique counter for fault site index;
 #                should differ based on application
+#    taint - add tracking clones that follow a corrupted
+#            value through memory (0 or 1); run with --taint
+#    inlineMask - corrupt by XORing a mask in the instrumented
+#            code instead of calling the runtime at every site;
+#            the runtime is only called on function entry, and
+#            the site it arms is corrupted on its first execution
+#            during that invocation of the function; cannot
+#            follow a --plan (0 or 1)
+#    siteModule - number of this library or executable; goes in
+#            the upper 32 bits of every fault site index so
+#            separately instrumented modules never share an index;
+#            4294967295 is reserved for MPI payload sites
+#    census - only find the fault sites: write the site log and
+#            <file>.census.csv of per function site counts, leave
+#            the code and the state file untouched (0 or 1)
+#    armedGuard - branch around every runtime call unless the
+#            runtime's FLIPIT_Armed flag is set, so the null shared
+#            runtime costs a load and a branch per site (0 or 1)
+#    rangeCheck - only loads and stores are sites, and they only
+#            call the runtime when their address is in a range
+#            registered with FLIPIT_RegisterRange (0 or 1)
 #
 #####################################################
 config = "FlipIt.config"
@@ -43,6 +64,12 @@ ptr = 1
 arith = 1
 ctrl = 1
 stateFile = "FlipItState"
+taint = 0
+inlineMask = 0
+siteModule = 0
+census = 0
+armedGuard = 0
+rangeCheck = 0
 
 ############# Library Parameters #####################
 #
@@ -69,3 +96,13 @@ verbose = True
 
 ############ Generate a histogram of fault site traversals #########
 histogram = False
+
+############ Link the shared runtime instead of libcorrupt(_histo).a #########
+# The null, profiling, and full runtimes in $FLIPIT_PATH/lib/{null,profile,full}
+# share one ABI; the binary finds the full one unless LD_LIBRARY_PATH (or
+# LD_PRELOAD) points at another, so one binary serves every phase of a
+# campaign. 'histogram' is ignored: use the profiling runtime instead.
+sharedRuntime = False
+
+############ Link the MPI message payload interception layer #########
+mpiPayload = False
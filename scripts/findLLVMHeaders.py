@@ -58,7 +58,22 @@ flipitHeaders = {'Pass.h': "#include <llvm\/Pass.h>",\
         #'PrintModulePass.h': "#include <llvm\/Assembly\/PrintModulePass.h>",\
         'DebugInfo.h': "#include <llvm\/DebugInfo.h>",\
         'Instruction.h': "#include <llvm\/IR\/Instruction.h>",\
-        'TypeBuilder.h': "#include <llvm\/IR\/TypeBuilder.h>"}
+        'TypeBuilder.h': "#include <llvm\/IR\/TypeBuilder.h>",\
+        'IntrinsicInst.h': "#include <llvm\/IR\/IntrinsicInst.h>",\
+        'PostOrderIterator.h': "#include <llvm\/ADT\/PostOrderIterator.h>",\
+        'CFG.h': "#include <llvm\/IR\/CFG.h>",\
+        'Dominators.h': "#include <llvm\/IR\/Dominators.h>",\
+        'BlockFrequencyInfo.h': "#include <llvm\/Analysis\/BlockFrequencyInfo.h>",\
+        'BranchProbabilityInfo.h': "#include <llvm\/Analysis\/BranchProbabilityInfo.h>",\
+        'LoopInfo.h': "#include <llvm\/Analysis\/LoopInfo.h>",\
+        'ScalarEvolution.h': "#include <llvm\/Analysis\/ScalarEvolution.h>",\
+        'ScalarEvolutionExpressions.h': "#include <llvm\/Analysis\/ScalarEvolutionExpressions.h>",\
+        'Cloning.h': "#include <llvm\/Transforms\/Utils\/Cloning.h>",\
+        'BasicBlockUtils.h': "#include <llvm\/Transforms\/Utils\/BasicBlockUtils.h>"}
+
+# directories (under llvm/) to look in for headers whose name is not unique
+flipitHeaderDirs = {'CFG.h': ["IR", "Support"],\
+        'Dominators.h': ["IR", "Analysis"]}
 
 # replace header files in 'faults.h' with the correct headers for the version 
 #of LLVM at $LLVM_REPO_PATH
@@ -69,6 +84,9 @@ infile.close()
 for path, subdirs, files in os.walk(LLVM_REPO_PATH + "/llvm"):
     for name in files:
         if name in flipitHeaders.keys():
+            if name in flipitHeaderDirs and \
+                    os.path.basename(path) not in flipitHeaderDirs[name]:
+                continue
             newInclude =  "#include <" + os.path.join( path[path.find("include")+8:], name) +">"
             #os.system("sed -i '/" + flipitHeaders[name] + "/c\\" + newInclude + "' " + filePath)
             for i in range(len(headerFile)):
@@ -26,10 +26,17 @@ if [[ -e $FLIPIT_PATH/lib/libcorrupt.a ]]
 fi
 
 gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/corrupt.c
-ar -cvq libcorrupt.a corrupt.o
-if [[ -e corrupt.o ]]; then
-	rm corrupt.o
-fi
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/taint.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/compare.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/trial.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/checkpoint.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/plan.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/telemetry.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/range.c
+gcc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/crash.c
+ar -cvq libcorrupt.a corrupt.o taint.o compare.o trial.o checkpoint.o plan.o telemetry.o range.o \
+	crash.o
+rm -f corrupt.o taint.o compare.o trial.o checkpoint.o plan.o telemetry.o range.o crash.o
 
 
 # With Histogram
@@ -39,7 +46,62 @@ if [[ -e $FLIPIT_PATH/lib/libcorrupt_histo.a ]]
 fi
 
 gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/corrupt.c -o corrupt_histogram.o
-ar -cvq libcorrupt_histo.a corrupt_histogram.o
-if [[ -e corrupt_histogram.o ]]; then
-	rm corrupt_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/taint.c -o taint_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/compare.c -o compare_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/trial.c -o trial_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/checkpoint.c \
+	-o checkpoint_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/plan.c -o plan_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/telemetry.c \
+	-o telemetry_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/range.c -o range_histogram.o
+gcc -O3 -fPIC -DFLIPIT_HISTOGRAM -c $FLIPIT_PATH/src/corrupt/crash.c -o crash_histogram.o
+ar -cvq libcorrupt_histo.a corrupt_histogram.o taint_histogram.o compare_histogram.o \
+	trial_histogram.o checkpoint_histogram.o plan_histogram.o telemetry_histogram.o \
+	range_histogram.o crash_histogram.o
+rm -f corrupt_histogram.o taint_histogram.o compare_histogram.o trial_histogram.o \
+	checkpoint_histogram.o plan_histogram.o telemetry_histogram.o range_histogram.o \
+	crash_histogram.o
+
+
+# Shared runtimes, one ABI and soname in three variants. A binary linked against
+# lib/full finds lib/null or lib/profile instead when LD_LIBRARY_PATH names it.
+#	null    - never injects, FLIPIT_Armed is 0 (golden runs)
+#	profile - counts site executions for FLIPIT_Finalize's histogram, never injects
+#	full    - the injecting runtime
+RUNTIME="corrupt.c taint.c compare.c trial.c checkpoint.c plan.c telemetry.c range.c crash.c"
+
+sharedRuntime() {
+	variant=$1
+	shift
+	mkdir -p $FLIPIT_PATH/lib/$variant
+	gcc -O3 -fPIC -shared "$@" -Wl,-soname,libcorrupt.so.1 \
+		-o $FLIPIT_PATH/lib/$variant/libcorrupt.so.1 \
+		$(for f in $RUNTIME; do echo $FLIPIT_PATH/src/corrupt/$f; done) -lm -lrt
+	ln -sf libcorrupt.so.1 $FLIPIT_PATH/lib/$variant/libcorrupt.so
+}
+
+sharedRuntime null -DFLIPIT_NULL
+sharedRuntime profile -DFLIPIT_NULL -DFLIPIT_HISTOGRAM
+sharedRuntime full
+
+
+# MPI message payload interception layer (only if an MPI compiler is around)
+if [[ -e $FLIPIT_PATH/lib/libcorrupt_mpi.a ]]
+ 	then
+	rm $FLIPIT_PATH/lib/libcorrupt_mpi.a
+fi
+
+if command -v mpicc > /dev/null; then
+	mpicc -O3 -fPIC -c $FLIPIT_PATH/src/corrupt/mpi_corrupt.c -o mpi_corrupt.o
+	ar -cvq libcorrupt_mpi.a mpi_corrupt.o
+	if [[ -e mpi_corrupt.o ]]; then
+		rm mpi_corrupt.o
+	fi
+fi
+
+# MPI master-worker runner of campaign trials (distributed in campaign_config.py)
+if command -v mpicc > /dev/null; then
+	mkdir -p $FLIPIT_PATH/bin
+	mpicc -O2 -o $FLIPIT_PATH/bin/flipit-dispatch $FLIPIT_PATH/src/campaign/dispatch.c
 fi
@@ -73,7 +73,6 @@ echo "
 Building the corruption library..."
 cd $FLIPIT_PATH/scripts/
 ./library.sh
-python ./genBC.py
 
 
 
@@ -82,6 +81,9 @@ if [[ -e libcorrupt.a ]]; then
 	if [[ -e libcorrupt_histo.a ]]; then
         cp libcorrupt_histo.a $FLIPIT_PATH/lib/
     fi
+	if [[ -e libcorrupt_mpi.a ]]; then
+        mv libcorrupt_mpi.a $FLIPIT_PATH/lib/
+    fi
     
 	# copy the library to a location that is in the library path
 	if [ "$(whoami)" != "root" ]; then
@@ -105,7 +107,6 @@ echo "
 Copying headers to include dir"
 cd $FLIPIT_PATH
 cp src/corrupt/*.h include/FlipIt/corrupt/
-cp src/corrupt/corrupt.bc include/FlipIt/corrupt/
 echo "Done!"
 echo ""
 echo "setup.sh terminating..."
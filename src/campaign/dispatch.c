@@ -0,0 +1,253 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: dispatch.c                                                                            */
+/*                                                                                             */
+/* Description: MPI master-worker runner of campaign trials (flipit-dispatch), started by      */
+/*              scripts/campaign/campaign.py with distributed = "mpirun -n <ranks>".           */
+/*                                                                                             */
+/*                  flipit-dispatch <tasks> <results> [-t <timeout seconds>]                   */
+/*                                                                                             */
+/*              Every line of tasks is "<trial>\t<output file>\t<shell command>". Rank 0 hands */
+/*              one line at a time to whichever worker asks for it, so long and short trials   */
+/*              balance themselves. A worker runs the command with /bin/sh in its own process  */
+/*              group, output appended to the output file, kills the group after the timeout,  */
+/*              and sends back a DispatchResult. Rank 0 appends one line per trial              */
+/*                                                                                             */
+/*                  trial=<#> status=<exit> signal=<#> timeout=<0|1> seconds=<s> rank=<#>      */
+/*                                                                                             */
+/*              to results as it arrives. The MPI variables of the job are removed from the    */
+/*              environment of the trial, so a trial can itself be an mpirun. With one rank,   */
+/*              rank 0 runs the trials itself.                                                 */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include <mpi.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define DISPATCH_TAG_RESULT 1
+#define DISPATCH_TAG_TASK   2
+
+typedef struct {
+    int64_t trial;          /* -1 for the first request of a worker */
+    int32_t status;         /* exit status, -1 if killed by a signal */
+    int32_t signal;
+    int32_t timedOut;
+    int32_t rank;
+    double  seconds;
+} DispatchResult;
+
+extern char** environ;
+
+static double dispatch_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/* OMPI_*, PMIX_*, and PMI_* tell an MPI library it is a rank of this job */
+static void dispatch_clearMPIEnvironment()
+{
+    char** e;
+    char name[256];
+    for (e = environ; *e != NULL; ) {
+        if (strncmp(*e, "OMPI_", 5) == 0 || strncmp(*e, "PMIX_", 5) == 0
+            || strncmp(*e, "PMI_", 4) == 0) {
+            size_t len = strcspn(*e, "=");
+            if (len >= sizeof(name))
+                len = sizeof(name) - 1;
+            memcpy(name, *e, len);
+            name[len] = '\0';
+            unsetenv(name);
+            e = environ;
+        }
+        else
+            e++;
+    }
+}
+
+/* runs one "<trial>\t<output>\t<command>" line */
+static void dispatch_run(char* line, double timeout, int rank, DispatchResult* res)
+{
+    char* output;
+    char* cmd;
+    double start;
+    pid_t pid;
+    int status = 0;
+
+    res->trial = strtoll(line, &output, 10);
+    res->status = 127;
+    res->signal = 0;
+    res->timedOut = 0;
+    res->rank = rank;
+    res->seconds = 0.;
+    if (*output != '\t' || (cmd = strchr(output + 1, '\t')) == NULL) {
+        fprintf(stderr, "flipit-dispatch: malformed task: %s\n", line);
+        return;
+    }
+    *output++ = '\0';
+    *cmd++ = '\0';
+
+    start = dispatch_now();
+    pid = fork();
+    if (pid < 0) {
+        perror("flipit-dispatch: fork failed");
+        return;
+    }
+    if (pid == 0) {
+        int fd = open(output, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        setpgid(0, 0);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        dispatch_clearMPIEnvironment();
+        execl("/bin/sh", "sh", "-c", cmd, (char*) NULL);
+        _exit(127);
+    }
+
+    /* the MPI library may own SIGCHLD, so the trial is polled */
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        struct timespec ts = {0, 10000000};
+        if (timeout > 0. && dispatch_now() - start > timeout) {
+            FILE* out;
+            kill(-pid, SIGKILL);
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            res->timedOut = 1;
+            if ((out = fopen(output, "a")) != NULL) {
+                fprintf(out, "\nFlipIt campaign: trial killed after %g seconds\n", timeout);
+                fclose(out);
+            }
+            break;
+        }
+        nanosleep(&ts, NULL);
+    }
+    res->seconds = dispatch_now() - start;
+    if (WIFEXITED(status))
+        res->status = WEXITSTATUS(status);
+    else {
+        res->status = -1;
+        res->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    }
+}
+
+static void dispatch_write(FILE* results, const DispatchResult* res)
+{
+    fprintf(results, "trial=%lld status=%d signal=%d timeout=%d seconds=%.3f rank=%d\n",
+            (long long) res->trial, res->status, res->signal, res->timedOut, res->seconds,
+            res->rank);
+    fflush(results);
+}
+
+static void dispatch_master(FILE* tasks, FILE* results, int size, double timeout)
+{
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int working = size - 1;
+    DispatchResult res;
+    MPI_Status st;
+
+    if (size == 1) {
+        while ((len = getline(&line, &cap, tasks)) > 0) {
+            if (line[len - 1] == '\n')
+                line[--len] = '\0';
+            if (len == 0)
+                continue;
+            dispatch_run(line, timeout, 0, &res);
+            dispatch_write(results, &res);
+        }
+        free(line);
+        return;
+    }
+
+    /* every worker asks for its first task with trial -1 and for the next with its result */
+    while (working > 0) {
+        MPI_Recv(&res, sizeof(res), MPI_BYTE, MPI_ANY_SOURCE, DISPATCH_TAG_RESULT,
+                 MPI_COMM_WORLD, &st);
+        if (res.trial >= 0)
+            dispatch_write(results, &res);
+        do {
+            len = getline(&line, &cap, tasks);
+            if (len > 0 && line[len - 1] == '\n')
+                line[--len] = '\0';
+        } while (len == 0);
+        if (len > 0)
+            MPI_Send(line, len + 1, MPI_CHAR, st.MPI_SOURCE, DISPATCH_TAG_TASK, MPI_COMM_WORLD);
+        else {
+            /* an empty task stops the worker */
+            MPI_Send(NULL, 0, MPI_CHAR, st.MPI_SOURCE, DISPATCH_TAG_TASK, MPI_COMM_WORLD);
+            working--;
+        }
+    }
+    free(line);
+}
+
+static void dispatch_worker(int rank, double timeout)
+{
+    DispatchResult res;
+    MPI_Status st;
+    char* line = NULL;
+    int count;
+
+    res.trial = -1;
+    res.rank = rank;
+    for (;;) {
+        MPI_Send(&res, sizeof(res), MPI_BYTE, 0, DISPATCH_TAG_RESULT, MPI_COMM_WORLD);
+        MPI_Probe(0, DISPATCH_TAG_TASK, MPI_COMM_WORLD, &st);
+        MPI_Get_count(&st, MPI_CHAR, &count);
+        line = (char*) realloc(line, count > 0 ? count : 1);
+        MPI_Recv(line, count, MPI_CHAR, 0, DISPATCH_TAG_TASK, MPI_COMM_WORLD, &st);
+        if (count == 0)
+            break;
+        dispatch_run(line, timeout, rank, &res);
+    }
+    free(line);
+}
+
+int main(int argc, char** argv)
+{
+    int rank, size, i;
+    double timeout = 0.;
+    FILE* tasks = NULL;
+    FILE* results = NULL;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (i = 3; i < argc - 1; i++)
+        if (strcmp("-t", argv[i]) == 0)
+            timeout = atof(argv[++i]);
+
+    if (rank == 0) {
+        if (argc < 3 || (tasks = fopen(argv[1], "r")) == NULL
+            || (results = fopen(argv[2], "a")) == NULL) {
+            fprintf(stderr, "Usage: flipit-dispatch <tasks> <results> [-t <timeout seconds>]\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        dispatch_master(tasks, results, size, timeout);
+        fclose(tasks);
+        fclose(results);
+    }
+    else
+        dispatch_worker(rank, timeout);
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: checkpoint.c                                                                          */
+/*                                                                                             */
+/* Description: Early termination of masked trials. The application registers the buffers    */
+/*              that hold its state and calls FLIPIT_Checkpoint at a fixed point of every      */
+/*              iteration. A golden run (--recordHashes) writes the hash of the state at every */
+/*              checkpoint. A trial (--goldenHashes) compares its hashes to those, and once a  */
+/*              fault has been injected and the state hashes the same as the golden run again, */
+/*              the fault is masked. FLIPIT_Checkpoint then returns FLIPIT_STATE_MASKED so the */
+/*              application can stop early, or, with FLIPIT_SetCheckpointExit, finalizes and   */
+/*              exits the process itself.                                                      */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "runtime.h"
+
+#define FLIPIT_MAX_STATES 32
+
+typedef struct {
+    const void* buf;
+    uint64_t nbytes;
+} FLIPIT_StateBuffer;
+
+static FLIPIT_StateBuffer FLIPIT_States[FLIPIT_MAX_STATES];
+static uint32_t FLIPIT_NumStates = 0;
+
+static FILE* FLIPIT_HashRecord = NULL;
+static uint64_t* FLIPIT_GoldenHashes = NULL;
+static uint64_t FLIPIT_NumGoldenHashes = 0;
+static uint64_t FLIPIT_CheckpointCount = 0;
+static int FLIPIT_CheckpointDiverged = 0;
+static int FLIPIT_CheckpointMasked = 0;
+static int FLIPIT_CheckpointExit = FLIPIT_OFF;
+
+static uint64_t flipit_stateHash();
+static void flipit_readGoldenHashes(FILE* infile);
+
+/***********************************************************************************************/
+/* The functions below are the functions that should be called by a user of FlipIt             */
+/***********************************************************************************************/
+
+/* registering a buffer again updates its size. Returns the number of registered buffers or
+   -1 if there is no room left */
+int FLIPIT_RegisterState(const void* buf, uint64_t nbytes) {
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumStates; i++)
+        if (FLIPIT_States[i].buf == buf) {
+            FLIPIT_States[i].nbytes = nbytes;
+            return FLIPIT_NumStates;
+        }
+    if (FLIPIT_NumStates == FLIPIT_MAX_STATES) {
+        printf("Warning: FlipIt can only hash %d state buffers; ignoring %p\n",
+               FLIPIT_MAX_STATES, buf);
+        return -1;
+    }
+    FLIPIT_States[FLIPIT_NumStates].buf = buf;
+    FLIPIT_States[FLIPIT_NumStates].nbytes = nbytes;
+    return ++FLIPIT_NumStates;
+}
+
+void FLIPIT_UnregisterState(const void* buf) {
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumStates; i++)
+        if (FLIPIT_States[i].buf == buf) {
+            FLIPIT_States[i] = FLIPIT_States[--FLIPIT_NumStates];
+            return;
+        }
+}
+
+void FLIPIT_SetCheckpointExit(int state) {
+    if (state == FLIPIT_ON || state == FLIPIT_OFF)
+        FLIPIT_CheckpointExit = state;
+}
+
+int FLIPIT_Checkpoint() {
+    uint64_t k = FLIPIT_CheckpointCount++;
+    uint64_t hash = flipit_stateHash();
+
+    if (FLIPIT_HashRecord != NULL) {
+        fprintf(FLIPIT_HashRecord, "%016llx\n", (unsigned long long) hash);
+        return FLIPIT_STATE_RECORDED;
+    }
+    if (FLIPIT_GoldenHashes == NULL || k >= FLIPIT_NumGoldenHashes)
+        return FLIPIT_STATE_UNKNOWN;
+
+    if (hash != FLIPIT_GoldenHashes[k]) {
+        if (!FLIPIT_CheckpointDiverged)
+            flipit_logEvent("checkpoint", "checkpoint=%llu state=diverged hash=%016llx",
+                            (unsigned long long) k, (unsigned long long) hash);
+        FLIPIT_CheckpointDiverged = 1;
+        FLIPIT_CheckpointMasked = 0;
+        return FLIPIT_STATE_DIVERGED;
+    }
+    /* masked only once every fault of the trial has been injected */
+    if (FLIPIT_GetInjectionCount() == 0
+        || FLIPIT_GetInjectionCount() < FLIPIT_GetMaxInjections())
+        return FLIPIT_STATE_GOLDEN;
+
+    flipit_logEvent("checkpoint", "checkpoint=%llu state=masked hash=%016llx",
+                    (unsigned long long) k, (unsigned long long) hash);
+    FLIPIT_CheckpointMasked = 1;
+    if (flipit_trialMasked())
+        return FLIPIT_STATE_MASKED;
+    /* only safe for a single process: an MPI rank leaving here would hang the others */
+    if (FLIPIT_CheckpointExit) {
+        flipit_finalizeTrial("masked");
+        exit(0);
+    }
+    return FLIPIT_STATE_MASKED;
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* the golden hashes (or the hashes being recorded) of this rank are in <name>_<rank> */
+void flipit_checkpointInit(char* golden, char* record) {
+    char filename[500];
+    FILE* infile;
+
+    if (record != NULL) {
+        snprintf(filename, sizeof(filename), "%s_%d", record, flipit_getRank());
+        FLIPIT_HashRecord = fopen(filename, "w");
+        if (FLIPIT_HashRecord == NULL)
+            printf("Warning: FlipIt could not write the state hashes to %s\n", filename);
+    }
+    else if (golden != NULL) {
+        snprintf(filename, sizeof(filename), "%s_%d", golden, flipit_getRank());
+        infile = fopen(filename, "r");
+        if (infile == NULL) {
+            printf("Warning: FlipIt could not read the golden state hashes %s\n", filename);
+            return;
+        }
+        flipit_readGoldenHashes(infile);
+        fclose(infile);
+    }
+}
+
+void flipit_checkpointReset() {
+    FLIPIT_CheckpointCount = 0;
+    FLIPIT_CheckpointDiverged = 0;
+    FLIPIT_CheckpointMasked = 0;
+}
+
+/* the last checkpoint found the fault masked, so the trial is recorded as such when the
+   application ends on it */
+int flipit_checkpointMasked() {
+    return FLIPIT_CheckpointMasked;
+}
+
+void flipit_checkpointFinalize() {
+    if (FLIPIT_HashRecord != NULL) {
+        fclose(FLIPIT_HashRecord);
+        FLIPIT_HashRecord = NULL;
+    }
+    if (FLIPIT_GoldenHashes != NULL) {
+        free(FLIPIT_GoldenHashes);
+        FLIPIT_GoldenHashes = NULL;
+    }
+    FLIPIT_NumGoldenHashes = 0;
+    FLIPIT_CheckpointMasked = 0;
+}
+
+/* FLIPIT_Checksum of every buffer, combined in registration order */
+static uint64_t flipit_stateHash() {
+    uint64_t h = FLIPIT_NumStates;
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumStates; i++)
+        h = (h ^ FLIPIT_Checksum(FLIPIT_States[i].buf, FLIPIT_States[i].nbytes))
+            * 0x9E3779B185EBCA87ULL + i;
+    return h;
+}
+
+static void flipit_readGoldenHashes(FILE* infile) {
+    uint64_t size = 1024;
+    unsigned long long hash;
+
+    FLIPIT_GoldenHashes = (uint64_t*) malloc(size * sizeof(uint64_t));
+    while (FLIPIT_GoldenHashes != NULL && fscanf(infile, "%llx", &hash) == 1) {
+        if (FLIPIT_NumGoldenHashes == size) {
+            size *= 2;
+            FLIPIT_GoldenHashes = (uint64_t*) realloc(FLIPIT_GoldenHashes,
+                                                      size * sizeof(uint64_t));
+            if (FLIPIT_GoldenHashes == NULL)
+                break;
+        }
+        FLIPIT_GoldenHashes[FLIPIT_NumGoldenHashes++] = hash;
+    }
+    if (FLIPIT_GoldenHashes == NULL) {
+        printf("Warning: FlipIt ran out of memory reading the golden state hashes\n");
+        FLIPIT_NumGoldenHashes = 0;
+    }
+}
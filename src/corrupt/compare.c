@@ -0,0 +1,210 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: compare.c                                                                             */
+/*                                                                                             */
+/* Description: Comparison of an application's output against a golden copy and a fast       */
+/*              checksum so golden outputs can be stored compactly. Buffers are compared in    */
+/*              blocks with a bitwise kernel the compiler vectorizes; only blocks that differ */
+/*              are examined element by element for absolute, relative, and ULP error.        */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "runtime.h"
+
+#define FLIPIT_COMPARE_BLOCK 64     /* elements per block */
+#define FLIPIT_CHECKSUM_LANES 4
+#define FLIPIT_CHECKSUM_PRIME1 0x9E3779B185EBCA87ULL
+#define FLIPIT_CHECKSUM_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+static uint64_t flipit_blockDiffers(const uint8_t* a, const uint8_t* b, uint64_t nbytes);
+static void flipit_compareBlock(const void* out, const void* golden, uint64_t first,
+                                uint64_t last, int type, double relTol, uint64_t ulpTol,
+                                FLIPIT_CompareResult* res);
+static uint64_t flipit_ulpDistance64(double a, double b);
+static uint64_t flipit_ulpDistance32(float a, float b);
+
+/***********************************************************************************************/
+/* The functions below are the functions that should be called by a user of FlipIt             */
+/***********************************************************************************************/
+
+uint64_t FLIPIT_CompareBuffers(const void* out, const void* golden, uint64_t n, int type,
+                               double relTol, uint64_t ulpTol, FLIPIT_CompareResult* res) {
+    FLIPIT_CompareResult tmp;
+    uint64_t size = FLIPIT_TypeSize(type);
+    uint64_t i;
+
+    if (res == NULL)
+        res = &tmp;
+    memset(res, 0, sizeof(FLIPIT_CompareResult));
+    res->firstIndex = -1;
+    if (size == 0)
+        return 0;
+
+    for (i = 0; i < n; i += FLIPIT_COMPARE_BLOCK) {
+        uint64_t last = i + FLIPIT_COMPARE_BLOCK < n ? i + FLIPIT_COMPARE_BLOCK : n;
+        if (flipit_blockDiffers((const uint8_t*) out + i*size, (const uint8_t*) golden + i*size,
+                                (last - i)*size))
+            flipit_compareBlock(out, golden, i, last, type, relTol, ulpTol, res);
+    }
+    res->checksum = FLIPIT_Checksum(out, n*size);
+
+    flipit_trialCompare(res);
+    return res->mismatches;
+}
+
+uint64_t FLIPIT_Checksum(const void* buf, uint64_t nbytes) {
+    const uint8_t* bytes = (const uint8_t*) buf;
+    uint64_t acc[FLIPIT_CHECKSUM_LANES] = {FLIPIT_CHECKSUM_PRIME1, FLIPIT_CHECKSUM_PRIME2,
+                                           ~FLIPIT_CHECKSUM_PRIME1, ~FLIPIT_CHECKSUM_PRIME2};
+    uint64_t nwords = nbytes / sizeof(uint64_t);
+    uint64_t i, h, tail = 0;
+    int j;
+
+    /* independent lanes so consecutive words do not wait on each other */
+    for (i = 0; i + FLIPIT_CHECKSUM_LANES <= nwords; i += FLIPIT_CHECKSUM_LANES) {
+        for (j = 0; j < FLIPIT_CHECKSUM_LANES; j++) {
+            uint64_t w;
+            memcpy(&w, bytes + (i + j)*sizeof(uint64_t), sizeof(uint64_t));
+            acc[j] = (acc[j] ^ w) * FLIPIT_CHECKSUM_PRIME1;
+            acc[j] ^= acc[j] >> 29;
+        }
+    }
+    for (; i < nwords; i++) {
+        uint64_t w;
+        memcpy(&w, bytes + i*sizeof(uint64_t), sizeof(uint64_t));
+        acc[0] = ((acc[0] ^ w) * FLIPIT_CHECKSUM_PRIME1);
+        acc[0] ^= acc[0] >> 29;
+    }
+    memcpy(&tail, bytes + nwords*sizeof(uint64_t), nbytes % sizeof(uint64_t));
+
+    h = nbytes * FLIPIT_CHECKSUM_PRIME2;
+    for (j = 0; j < FLIPIT_CHECKSUM_LANES; j++)
+        h = (h ^ acc[j]) * FLIPIT_CHECKSUM_PRIME2 + (h >> 31);
+    h = (h ^ tail) * FLIPIT_CHECKSUM_PRIME1;
+    h ^= h >> 33;
+    h *= FLIPIT_CHECKSUM_PRIME2;
+    h ^= h >> 29;
+    return h;
+}
+
+uint64_t FLIPIT_TypeSize(int type) {
+    switch (type) {
+        case FLIPIT_FLOAT:  return sizeof(float);
+        case FLIPIT_DOUBLE: return sizeof(double);
+        case FLIPIT_INT8:   return sizeof(int8_t);
+        case FLIPIT_INT16:  return sizeof(int16_t);
+        case FLIPIT_INT32:  return sizeof(int32_t);
+        case FLIPIT_INT64:  return sizeof(int64_t);
+        default:            return 0;
+    }
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* bitwise comparison of a block; written so the compiler turns it into SIMD xor/or */
+static uint64_t flipit_blockDiffers(const uint8_t* a, const uint8_t* b, uint64_t nbytes) {
+    uint64_t diff = 0;
+    uint64_t nwords = nbytes / sizeof(uint64_t);
+    uint64_t i;
+
+    for (i = 0; i < nwords; i++) {
+        uint64_t x, y;
+        memcpy(&x, a + i*sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&y, b + i*sizeof(uint64_t), sizeof(uint64_t));
+        diff |= x ^ y;
+    }
+    for (i = nwords*sizeof(uint64_t); i < nbytes; i++)
+        diff |= a[i] ^ b[i];
+    return diff;
+}
+
+#define FLIPIT_COMPARE_ELEMENT(absErr, relErr, ulpErr, idx)                                    \
+    do {                                                                                       \
+        if ((absErr) > res->maxAbsError) res->maxAbsError = (absErr);                          \
+        if ((relErr) > res->maxRelError) res->maxRelError = (relErr);                          \
+        if ((ulpErr) > res->maxULPError) res->maxULPError = (ulpErr);                          \
+        if ((ulpErr) > ulpTol && (relErr) > relTol) {                                          \
+            res->mismatches++;                                                                 \
+            if (res->firstIndex < 0) res->firstIndex = (int64_t) (idx);                        \
+        }                                                                                      \
+    } while (0)
+
+static void flipit_compareBlock(const void* out, const void* golden, uint64_t first,
+                                uint64_t last, int type, double relTol, uint64_t ulpTol,
+                                FLIPIT_CompareResult* res) {
+    uint64_t i;
+
+    for (i = first; i < last; i++) {
+        double absErr, relErr, ref;
+        uint64_t ulpErr;
+
+        if (type == FLIPIT_FLOAT) {
+            float a = ((const float*) out)[i], b = ((const float*) golden)[i];
+            ulpErr = flipit_ulpDistance32(a, b);
+            absErr = fabs((double) a - (double) b);
+            ref = fabs((double) b);
+        }
+        else if (type == FLIPIT_DOUBLE) {
+            double a = ((const double*) out)[i], b = ((const double*) golden)[i];
+            ulpErr = flipit_ulpDistance64(a, b);
+            absErr = fabs(a - b);
+            ref = fabs(b);
+        }
+        else {
+            int64_t a, b;
+            switch (type) {
+                case FLIPIT_INT8:  a = ((const int8_t*) out)[i];  b = ((const int8_t*) golden)[i];  break;
+                case FLIPIT_INT16: a = ((const int16_t*) out)[i]; b = ((const int16_t*) golden)[i]; break;
+                case FLIPIT_INT32: a = ((const int32_t*) out)[i]; b = ((const int32_t*) golden)[i]; break;
+                default:           a = ((const int64_t*) out)[i]; b = ((const int64_t*) golden)[i]; break;
+            }
+            ulpErr = a > b ? (uint64_t) a - (uint64_t) b : (uint64_t) b - (uint64_t) a;
+            absErr = (double) ulpErr;
+            ref = fabs((double) b);
+        }
+
+        /* NaNs and infinities that differ count as infinitely wrong */
+        if (ulpErr == 0)
+            relErr = 0.;
+        else if (absErr != absErr || isinf(absErr))
+            absErr = relErr = INFINITY;
+        else
+            relErr = ref > 0. ? absErr / ref : INFINITY;
+        FLIPIT_COMPARE_ELEMENT(absErr, relErr, ulpErr, i);
+    }
+}
+
+/* distance between two floating-point values in units in the last place */
+static uint64_t flipit_ulpDistance64(double a, double b) {
+    int64_t x, y;
+    memcpy(&x, &a, sizeof(double));
+    memcpy(&y, &b, sizeof(double));
+    if (x == y)
+        return 0;
+    if (a != a || b != b)
+        return UINT64_MAX;
+    /* map the sign-magnitude encoding onto a monotonic integer line */
+    if (x < 0) x = INT64_MIN - x;
+    if (y < 0) y = INT64_MIN - y;
+    return x > y ? (uint64_t) x - (uint64_t) y : (uint64_t) y - (uint64_t) x;
+}
+
+static uint64_t flipit_ulpDistance32(float a, float b) {
+    int32_t x, y;
+    memcpy(&x, &a, sizeof(float));
+    memcpy(&y, &b, sizeof(float));
+    if (x == y)
+        return 0;
+    if (a != a || b != b)
+        return UINT64_MAX;
+    if (x < 0) x = INT32_MIN - x;
+    if (y < 0) y = INT32_MIN - y;
+    return x > y ? (uint64_t) ((int64_t) x - y) : (uint64_t) ((int64_t) y - x);
+}
@@ -13,25 +13,36 @@
 /*                                                                                             */
 /***********************************************************************************************/
 
-#include "corrupt.h"
-
-#define FAULT_IDX_MASK 0x00FFFFFF
+#include <stdarg.h>
+#include "runtime.h"
 
 static uint32_t FLIPIT_MaxInjections = 1;
 static uint32_t FLIPIT_State = 0;
+static int64_t FLIPIT_SeedOverride = -1;
 
 
 /*fault injection count*/
 static uint32_t FLIPIT_InjectionCount = 0;
 static uint64_t FLIPIT_Attempts = 0;
 static uint64_t FLIPIT_InjCountdown = 0;
+static uint64_t FLIPIT_CountdownStart = 0;
 static uint64_t FLIPIT_TotalInsts = 0;
 
 /*Fault Injection Statistics*/
+#ifdef FLIPIT_HISTOGRAM
 static uint64_t* FLIPIT_Histogram;
+static uint64_t FLIPIT_HistogramOther = 0;
+#endif
+static uint64_t FLIPIT_SiteBase = 0;
 static uint32_t FLIPIT_MAX_LOC = 20000;
+static uint64_t FLIPIT_NumSites = 0;
 static char* FLIPIT_StateFile = NULL;
 
+/* the site tables of the instrumented modules (FLIPIT_SiteTable), defined by the linker if the
+   executable has any */
+extern const char __start_flipit_sites[] __attribute__((weak));
+extern const char __stop_flipit_sites[] __attribute__((weak));
+
 static uint32_t FLIPIT_MAX_INJECT_LINES = 33554432;
 static uint32_t FLIPIT_REMAIN_INJECT_COUNT = 1;  
 static uint32_t FLIPIT_char_type_size = sizeof(char);
@@ -40,23 +51,106 @@ static uint32_t FLIPIT_char_type_size = sizeof(char);
 static uint32_t FLIPIT_Rank = 0;                   
 static uint32_t FLIPIT_RankInject = 0;
 
+/* MPI message payload injections */
+static uint32_t FLIPIT_PayloadMode = FLIPIT_PAYLOAD_OFF;
+static double FLIPIT_PayloadProb = 1e-3;
+
 /* Selective Injections */
-static uint32_t* FLIPIT_FaultSites = NULL;
+static uint64_t* FLIPIT_FaultSites = NULL;
 static int32_t FLIPIT_NumFaultSites = -1;
 
 
+/* structured events (FLIPIT_EVENT lines) read by the analysis scripts */
+static FILE* FLIPIT_EventLog = NULL;
+static char* FLIPIT_EventLogName = NULL;
+
+/* campaign plan file (plan.c); the trial is the --planTrial one, or else the trial number of
+   the persistent trial loop, or 0 */
+static char* FLIPIT_PlanName = NULL;
+static int64_t FLIPIT_PlanTrial = -1;
+
+/* state hashes of the golden run (checkpoint.c) */
+static char* FLIPIT_GoldenHashName = NULL;
+static char* FLIPIT_RecordHashName = NULL;
+
+/* shared memory name of the live telemetry page (telemetry.c) */
+static char* FLIPIT_TelemetryName = NULL;
+
+/* crash record (--crashRecord, crash.c) */
+static char* FLIPIT_CrashRecordName = NULL;
+
+/* structured record of the trial emitted by FLIPIT_Finalize or FLIPIT_TrialEnd. Trial
+   numbers start at 0 with FLIPIT_TrialBegin; -1 means one trial per process */
+static int64_t FLIPIT_Trial = -1;
+static int64_t FLIPIT_TrialFirstSite = -1;
+static uint64_t FLIPIT_TrialCompares = 0;
+static int64_t FLIPIT_TrialFirstBuffer = -1;
+static FLIPIT_CompareResult FLIPIT_TrialResult = {0, -1, 0., 0., 0, 0};
+
+static void (*FLIPIT_InitHook)(uint32_t, char**) = NULL;
+static int (*FLIPIT_FaultClaim)(uint64_t) = NULL;
 static void (*FLIPIT_CustomLogger)(FILE*) = NULL;
 static void (*FLIPIT_CountdownCustomLogger)(FILE*) = NULL;
 static double (*FLIPIT_FaultProb)() = NULL;
 
 static void flipit_parseArgs(uint32_t argc, char** argv);
 static uint8_t flipit_shouldInjectNoCheck(); 
-static uint8_t flipit_checkActiveFaultSite(uint32_t fault_index);
-static void flipit_print_injectedErr(char* type, unsigned int bPos, int fault_index, double prob,
-                                     double p);
+static uint8_t flipit_checkActiveFaultSite(uint64_t fault_index);
+static void flipit_print_injectedErr(char* type, unsigned int bPos, uint64_t fault_index,
+                                     double prob, double p);
+static void flipit_injected(char* type, unsigned int bPos, uint64_t fault_index, double prob,
+                            double p);
 static double flipit_countdown();
+static uint64_t flipit_siteTableCount();
 static void flipit_countdownLogger(FILE*);
 
+/* sites are 64-bit; the histogram covers FLIPIT_MAX_LOC of them starting at FLIPIT_SiteBase
+   (--siteBase) and everything else is counted together */
+#ifdef FLIPIT_HISTOGRAM
+#define FLIPIT_HISTOGRAM_SITE(site)                                                            \
+    do {                                                                                       \
+        uint64_t idx = (site) - FLIPIT_SiteBase;                                               \
+        if (idx < FLIPIT_MAX_LOC) FLIPIT_Histogram[idx]++;                                     \
+        else FLIPIT_HistogramOther++;                                                          \
+    } while (0)
+#else
+#define FLIPIT_HISTOGRAM_SITE(site)
+#endif
+
+/* with --telemetry every thread counts its site executions and publishes them to the
+   telemetry page once every FLIPIT_TELEMETRY_BATCH of them (telemetry.c) */
+#define FLIPIT_TELEMETRY_SITE()                                                                \
+    do {                                                                                       \
+        if (FLIPIT_TelemetryOn                                                                 \
+            && (++FLIPIT_TelemetrySites & (FLIPIT_TELEMETRY_BATCH - 1)) == 0)                  \
+            flipit_telemetryFlush();                                                           \
+    } while (0)
+
+#define FLIPIT_COUNT_SITE(site)                                                                \
+    do {                                                                                       \
+        FLIPIT_HISTOGRAM_SITE(site);                                                           \
+        FLIPIT_TELEMETRY_SITE();                                                               \
+    } while (0)
+
+/* a -rangeCheck site whose address only hit the hull of more than two ranges (range.c) */
+#define FLIPIT_RANGE_MISS()                                                                    \
+    (FLIPIT_RangeSearch && FLIPIT_RangeAddr != 0 && !flipit_rangeHit(FLIPIT_RangeAddr))
+
+/* the null and profiling shared runtimes (-DFLIPIT_NULL, see library.sh) keep the ABI of the
+   full runtime but never inject: the corrupt functions return once the site is counted. Only
+   the null runtime leaves FLIPIT_Armed clear, which code compiled with -armedGuard checks
+   instead of calling into the runtime at all */
+#ifdef FLIPIT_NULL
+#define FLIPIT_NULL_RETURN(value) return value
+#else
+#define FLIPIT_NULL_RETURN(value)
+#endif
+#if defined(FLIPIT_NULL) && !defined(FLIPIT_HISTOGRAM)
+int32_t FLIPIT_Armed = 0;
+#else
+int32_t FLIPIT_Armed = 1;
+#endif
+
 /***********************************************************************************************/
 /* The functions below are the functions that should be called by a user of FlipIt             */
 /***********************************************************************************************/
@@ -64,34 +158,52 @@ static void flipit_countdownLogger(FILE*);
 void FLIPIT_Init(uint32_t myRank, uint32_t argc, char** argv, uint64_t seed) {
     FILE* infile;
     FLIPIT_Rank = myRank;
-    int amount;
+    unsigned long long amount = 0;
     flipit_parseArgs(argc, argv);
+    if (FLIPIT_SeedOverride >= 0)
+        seed = FLIPIT_SeedOverride;
 
     if (FLIPIT_Rank == 0)
         printf("Fault injector seed: %llu\n", (unsigned long long)seed+myRank);
     
-    infile = fopen(FLIPIT_StateFile, "r");
-    
-    if (infile) {
-        int ret = fscanf(infile, "%d", &amount);
-        if (amount > FLIPIT_MAX_LOC)
-            FLIPIT_MAX_LOC = amount;
+    /* the state file is only read for executables built without site tables */
+    amount = flipit_siteTableCount();
+    if (amount == 0 && (infile = fopen(FLIPIT_StateFile, "r")) != NULL) {
+        if (fscanf(infile, "%llu", &amount) != 1)
+            amount = 0;
         fclose(infile);
     }
+    if (amount > 0)
+        FLIPIT_NumSites = amount;
+    if (amount > FLIPIT_MAX_LOC && amount <= UINT32_MAX)
+        FLIPIT_MAX_LOC = amount;
 #ifdef FLIPIT_HISTOGRAM
     FLIPIT_Histogram = (uint64_t*) calloc(FLIPIT_MAX_LOC, sizeof(uint64_t));
 #endif
 #ifdef FLIPIT_DEBUG
     printf("Rank %d alloced an FLIPIT_Histogram of length: %d\n", FLIPIT_Rank, FLIPIT_MAX_LOC);
 #endif
-    FLIPIT_State = FLIPIT_ON;
+    if (FLIPIT_EventLogName != NULL) {
+        char filename[500];
+        snprintf(filename, sizeof(filename), "%s_%d", FLIPIT_EventLogName, FLIPIT_Rank);
+        FLIPIT_EventLog = fopen(filename, "w");
+    }
+    flipit_telemetryInit(FLIPIT_TelemetryName, FLIPIT_Rank, FLIPIT_NumSites);
+    flipit_crashInit(FLIPIT_CrashRecordName, FLIPIT_Rank);
+    flipit_checkpointInit(FLIPIT_GoldenHashName, FLIPIT_RecordHashName);
+    if (FLIPIT_PlanName != NULL && flipit_planOpen(FLIPIT_PlanName))
+        flipit_planSelect(FLIPIT_PlanTrial >= 0 ? FLIPIT_PlanTrial : 0, FLIPIT_Rank);
+    /* the run recording the golden state hashes must not inject */
+    FLIPIT_State = FLIPIT_RecordHashName == NULL ? FLIPIT_ON : FLIPIT_OFF;
     srand(seed + myRank);
     srand48(seed + myRank);
     FLIPIT_SetFaultProbability(drand48);
+    if (FLIPIT_InitHook != NULL)
+        FLIPIT_InitHook(argc, argv);
 }
 
 void FLIPIT_Finalize(char* fname) {
-    int i;
+    uint32_t i;
     FILE* outfile;
 #ifdef FLIPIT_HISTOGRAM
     if (fname != NULL) {
@@ -104,14 +216,37 @@ void FLIPIT_Finalize(char* fname) {
 
         outfile = fopen(filename, "w");
         for (i = 0; i < FLIPIT_MAX_LOC; i++)
-            fprintf(outfile, "Location %i: %lu\n", i, FLIPIT_Histogram[i]);
+            fprintf(outfile, "Location %llu: %llu\n", (unsigned long long) (FLIPIT_SiteBase + i),
+                    (unsigned long long) FLIPIT_Histogram[i]);
+        if (FLIPIT_HistogramOther > 0)
+            fprintf(outfile, "Location other: %llu\n",
+                    (unsigned long long) FLIPIT_HistogramOther);
         fclose(outfile);
     }
     
     free(FLIPIT_Histogram);
 #endif
-    if (FLIPIT_FaultSites != NULL)
-        free(FLIPIT_FaultSites);
+    flipit_finalizeTrial(flipit_checkpointMasked() ? "masked" : "completed");
+}
+
+/* everything FLIPIT_Finalize does but the histogram, whose file name only the application
+   knows; also called by a process that ends its trial early (checkpoint.c) */
+void flipit_finalizeTrial(char* outcome) {
+    flipit_taintFinalize();
+    flipit_checkpointFinalize();
+    flipit_planClose();
+    flipit_telemetryFinalize();
+    flipit_crashFinalize();
+    if (FLIPIT_Trial < 0)
+        flipit_logTrial(outcome, 0);
+    if (FLIPIT_EventLog != NULL) {
+        fclose(FLIPIT_EventLog);
+        FLIPIT_EventLog = NULL;
+    }
+    /* a later FLIPIT_Init starts without a fault site list */
+    free(FLIPIT_FaultSites);
+    FLIPIT_FaultSites = NULL;
+    FLIPIT_NumFaultSites = -1;
 }
 
 void FLIPIT_SetInjector(int state) {
@@ -143,10 +278,14 @@ void FLIPIT_SetCustomLogger(void (logger)(FILE*)) {
 
 void FLIPIT_CountdownTimer(unsigned long numInstructions) {
     FLIPIT_InjCountdown = numInstructions;
+    FLIPIT_CountdownStart = numInstructions;
     FLIPIT_SetFaultProbability(flipit_countdown);
     
-    FLIPIT_CountdownCustomLogger = FLIPIT_CustomLogger;
-    FLIPIT_CustomLogger = flipit_countdownLogger;
+    /* may be called again to re-arm (e.g. before each FLIPIT_TrialBegin) */
+    if (FLIPIT_CustomLogger != flipit_countdownLogger) {
+        FLIPIT_CountdownCustomLogger = FLIPIT_CustomLogger;
+        FLIPIT_CustomLogger = flipit_countdownLogger;
+    }
 }
 
 unsigned long long FLIPIT_GetExecutedInstructionCount() {
@@ -159,9 +298,10 @@ int FLIPIT_GetInjectionCount() {
 
 void FLIPIT_SetMaxInjections(int n)
 {
-    if (n < 0)
+    if (n < 0) {
         printf("Warning: Attempting to set Max Injections to negative value %d. Defaulting to 1.\n", n);
         n  = 1;
+    }
 
     // set max number of injections for this rank;
     // then calculate the remaing number of injections if any
@@ -179,6 +319,23 @@ int FLIPIT_GetMaxInjections()
 {
     return FLIPIT_MaxInjections;
 }
+
+uint64_t FLIPIT_GetSiteCount() {
+    return FLIPIT_NumSites;
+}
+
+void FLIPIT_SetPayloadInjection(int mode, double prob) {
+    if (mode >= FLIPIT_PAYLOAD_OFF && mode <= FLIPIT_PAYLOAD_BOTH)
+        FLIPIT_PayloadMode = mode;
+    if (prob >= 0.)
+        FLIPIT_PayloadProb = prob;
+}
+
+int FLIPIT_GetPayloadInjection(double* prob) {
+    if (prob != NULL)
+        *prob = FLIPIT_PayloadProb;
+    return FLIPIT_PayloadMode;
+}
 /***********************************************************************************************/
 /* User callable function for FORTRAN wrapper                                              */
 /***********************************************************************************************/
@@ -223,6 +380,93 @@ int flipit_countdowntimer_ftn_(unsigned long* numInstructions) {
 /* The functions below this are used internally by FlipIt                                      */
 /***********************************************************************************************/
 
+void flipit_setInitHook(void (*hook)(uint32_t argc, char** argv)) {
+    FLIPIT_InitHook = hook;
+}
+
+void flipit_setFaultClaim(int (*claim)(uint64_t site)) {
+    FLIPIT_FaultClaim = claim;
+}
+
+/* whether a site can inject at all, for callers that have work to do before asking */
+int flipit_injectorOn() {
+    if (flipit_planActive())
+        return FLIPIT_PlanLeft > 0;
+    return FLIPIT_State != 0 && FLIPIT_RankInject != 0 && FLIPIT_REMAIN_INJECT_COUNT != 0;
+}
+
+uint32_t flipit_getRank() {
+    return FLIPIT_Rank;
+}
+
+/* one line per event: FLIPIT_EVENT <event> rank=<rank> inst=<dynamic site count> key=value ... */
+void flipit_logEvent(char* event, char* fmt, ...) {
+    va_list args;
+    FILE* log = FLIPIT_EventLog != NULL ? FLIPIT_EventLog : stdout;
+
+    fprintf(log, "FLIPIT_EVENT %s rank=%u inst=%llu ", event, FLIPIT_Rank,
+            (unsigned long long) FLIPIT_TotalInsts);
+    va_start(args, fmt);
+    vfprintf(log, fmt, args);
+    va_end(args);
+    fprintf(log, "\n");
+}
+
+/* fold the result of a comparison into the trial record. The first mismatch is reported as
+   the index inside the first buffer (numbered in call order) that had one */
+void flipit_trialCompare(const FLIPIT_CompareResult* res) {
+    FLIPIT_CompareResult* t = &FLIPIT_TrialResult;
+    if (t->firstIndex < 0 && res->firstIndex >= 0) {
+        t->firstIndex = res->firstIndex;
+        FLIPIT_TrialFirstBuffer = FLIPIT_TrialCompares;
+    }
+    t->mismatches += res->mismatches;
+    if (res->maxAbsError > t->maxAbsError) t->maxAbsError = res->maxAbsError;
+    if (res->maxRelError > t->maxRelError) t->maxRelError = res->maxRelError;
+    if (res->maxULPError > t->maxULPError) t->maxULPError = res->maxULPError;
+    t->checksum = (t->checksum ^ res->checksum) * 0x9E3779B185EBCA87ULL + FLIPIT_TrialCompares;
+    FLIPIT_TrialCompares++;
+}
+
+/* one record per trial; outcome is "completed" or "crashed" (signal holds the signal) */
+void flipit_logTrial(char* outcome, int signal) {
+    FLIPIT_CompareResult* t = &FLIPIT_TrialResult;
+    flipit_logEvent("trial", "trial=%lld outcome=%s signal=%d injections=%u first_site=%lld "
+                    "compares=%llu mismatches=%llu first_buffer=%lld first_mismatch=%lld "
+                    "max_abs=%e max_rel=%e max_ulp=%llu checksum=%016llx",
+                    (long long) FLIPIT_Trial, outcome, signal, FLIPIT_InjectionCount,
+                    (long long) FLIPIT_TrialFirstSite, (unsigned long long) FLIPIT_TrialCompares,
+                    (unsigned long long) t->mismatches, (long long) FLIPIT_TrialFirstBuffer,
+                    (long long) t->firstIndex, t->maxAbsError, t->maxRelError,
+                    (unsigned long long) t->maxULPError, (unsigned long long) t->checksum);
+}
+
+/* fresh per-trial state for the persistent trial loop (trial.c). The fault site filter,
+   rank selection, and histogram are kept across trials */
+void flipit_trialReset(uint64_t seed) {
+    FLIPIT_Trial++;
+    /* an exhausted budget switches off this rank; it was selected, so give it back */
+    if (FLIPIT_InjectionCount > 0 && FLIPIT_REMAIN_INJECT_COUNT == 0)
+        FLIPIT_RankInject = 1;
+    FLIPIT_InjectionCount = 0;
+    FLIPIT_Attempts = 0;
+    FLIPIT_TotalInsts = 0;
+    FLIPIT_REMAIN_INJECT_COUNT = FLIPIT_MaxInjections;
+    if (FLIPIT_FaultProb == flipit_countdown)
+        FLIPIT_InjCountdown = FLIPIT_CountdownStart;
+
+    FLIPIT_TrialFirstSite = -1;
+    FLIPIT_TrialCompares = 0;
+    FLIPIT_TrialFirstBuffer = -1;
+    memset(&FLIPIT_TrialResult, 0, sizeof(FLIPIT_CompareResult));
+    FLIPIT_TrialResult.firstIndex = -1;
+    flipit_checkpointReset();
+    if (flipit_planActive())
+        flipit_planSelect(FLIPIT_PlanTrial >= 0 ? FLIPIT_PlanTrial : FLIPIT_Trial, FLIPIT_Rank);
+
+    srand(seed + FLIPIT_Rank);
+    srand48(seed + FLIPIT_Rank);
+}
 
 static void flipit_parseArgs(uint32_t argc, char** argv) {
     int i, j;
@@ -241,13 +485,46 @@ static void flipit_parseArgs(uint32_t argc, char** argv) {
         else if (strcmp("--numberFaultLoc", argv[i]) == 0 || strcmp("-nLOC", argv[i]) == 0)
             FLIPIT_NumFaultSites = atoi(argv[++i]);
         else if (strcmp("--faultyLoc", argv[i]) == 0 || strcmp("-fLOC", argv[i]) == 0) {
-            FLIPIT_FaultSites = (uint32_t*) malloc( sizeof(uint32_t) * FLIPIT_NumFaultSites);
+            FLIPIT_FaultSites = (uint64_t*) malloc( sizeof(uint64_t) * FLIPIT_NumFaultSites);
             for(j = 0; j < FLIPIT_NumFaultSites; j++) 
-                FLIPIT_FaultSites[j] = atoi(argv[i + j + 1]);
+                FLIPIT_FaultSites[j] = strtoull(argv[i + j + 1], NULL, 0);
             i += j;
         }
+        else if (strcmp("--mpiPayload", argv[i]) == 0 || strcmp("-mP", argv[i]) == 0) {
+            i++;
+            if (strcmp("send", argv[i]) == 0)
+                FLIPIT_PayloadMode = FLIPIT_PAYLOAD_SEND;
+            else if (strcmp("recv", argv[i]) == 0)
+                FLIPIT_PayloadMode = FLIPIT_PAYLOAD_RECV;
+            else if (strcmp("both", argv[i]) == 0)
+                FLIPIT_PayloadMode = FLIPIT_PAYLOAD_BOTH;
+            else
+                FLIPIT_PayloadMode = FLIPIT_PAYLOAD_OFF;
+        }
+        else if (strcmp("--mpiProb", argv[i]) == 0 || strcmp("-mProb", argv[i]) == 0)
+            FLIPIT_PayloadProb = atof(argv[++i]);
+        else if (strcmp("--taint", argv[i]) == 0 || strcmp("-t", argv[i]) == 0)
+            FLIPIT_SetTaintTracking(FLIPIT_ON);
+        else if (strcmp("--seed", argv[i]) == 0 || strcmp("-sd", argv[i]) == 0)
+            FLIPIT_SeedOverride = strtoll(argv[++i], NULL, 0);
+        else if (strcmp("--siteBase", argv[i]) == 0 || strcmp("-sB", argv[i]) == 0)
+            FLIPIT_SiteBase = strtoull(argv[++i], NULL, 0);
+        else if (strcmp("--eventLog", argv[i]) == 0 || strcmp("-eL", argv[i]) == 0)
+            FLIPIT_EventLogName = argv[++i];
+        else if (strcmp("--plan", argv[i]) == 0 || strcmp("-pl", argv[i]) == 0)
+            FLIPIT_PlanName = argv[++i];
+        else if (strcmp("--planTrial", argv[i]) == 0 || strcmp("-pT", argv[i]) == 0)
+            FLIPIT_PlanTrial = strtoll(argv[++i], NULL, 0);
+        else if (strcmp("--telemetry", argv[i]) == 0 || strcmp("-tm", argv[i]) == 0)
+            FLIPIT_TelemetryName = argv[++i];
+        else if (strcmp("--crashRecord", argv[i]) == 0 || strcmp("-cR", argv[i]) == 0)
+            FLIPIT_CrashRecordName = argv[++i];
+        else if (strcmp("--goldenHashes", argv[i]) == 0 || strcmp("-gH", argv[i]) == 0)
+            FLIPIT_GoldenHashName = argv[++i];
+        else if (strcmp("--recordHashes", argv[i]) == 0 || strcmp("-rH", argv[i]) == 0)
+            FLIPIT_RecordHashName = argv[++i];
         else if (strcmp("--stateFile", argv[i]) == 0 || strcmp("-sF", argv[i]) == 0) {
-            int len = strlen(argv[i]) + 1;
+            int len = strlen(argv[++i]) + 1;
             FLIPIT_StateFile = (char*) malloc(sizeof(char)*len);
             strcpy(FLIPIT_StateFile, argv[i]);
         }
@@ -274,7 +551,7 @@ static void flipit_parseArgs(uint32_t argc, char** argv) {
         else
             printf("Faulty sites(%d):\n", FLIPIT_NumFaultSites);
         for (i = 0; i < FLIPIT_NumFaultSites; i++)
-            printf("%d\n", FLIPIT_FaultSites[i] );
+            printf("%llu\n", (unsigned long long) FLIPIT_FaultSites[i] );
         printf("Num faulty = %d\n", numFaulty);
     } 
 #endif
@@ -287,11 +564,12 @@ static uint8_t flipit_shouldInjectNoCheck() {
         || (0 == FLIPIT_REMAIN_INJECT_COUNT))  //CS
         return 0;
     FLIPIT_Attempts++;                                      //CS
+    if (FLIPIT_TelemetryOn) FLIPIT_TelemetryAttempts++;
     return 1;   
 }
 
 
-static uint8_t flipit_checkActiveFaultSite(uint32_t fault_index) {
+static uint8_t flipit_checkActiveFaultSite(uint64_t fault_index) {
 /*
     FLIPIT_TotalInsts++;                                    //CS
     if ((0 == FLIPIT_State) || (0 == FLIPIT_RankInject) || (0 == FLIPIT_REMAIN_INJECT_COUNT)) //CS
@@ -323,28 +601,48 @@ static uint8_t flipit_checkActiveFaultSite(uint32_t fault_index) {
     }
     else
         inject = 1;
+
+    /* the last check before a fault goes in: a job-wide budget (mpi_corrupt.c) may say no */
+    if (inject && FLIPIT_FaultClaim != NULL)
+        inject = FLIPIT_FaultClaim(fault_index);
     
     //FLIPIT_Attempts += inject;
     return inject;
 }
 
-static void flipit_print_injectedErr(char* type, unsigned int bPos, int fault_index, double prob,
-                                     double p) {
+static void flipit_print_injectedErr(char* type, unsigned int bPos, uint64_t fault_index,
+                                     double prob, double p) {
+    if (FLIPIT_TrialFirstSite < 0)
+        FLIPIT_TrialFirstSite = (int64_t) fault_index;
     printf("\n/*********************************Start**************************************/\n"
             "\nSuccessfully injected %s error!!\nRank: %d\n"
             "Total # faults injected: %d\n" 
             "Bit position is: %u\n"
-            "Index of the fault site: %d\n"
+            "Index of the fault site: %llu\n"
             "Fault site probability: %e\n"
             "Chosen random probability is: %e\n" 
             "Attempts since last injection: %lu\n", type, FLIPIT_Rank, FLIPIT_InjectionCount,
-                                                    bPos, fault_index, 
+                                                    bPos, (unsigned long long) fault_index,
             prob, p, FLIPIT_Attempts);   
     if (FLIPIT_CustomLogger != NULL)
         FLIPIT_CustomLogger(stdout);
     printf("\n/*********************************End**************************************/\n");
 }
 
+/* book keeping common to every injection */
+static void flipit_injected(char* type, unsigned int bPos, uint64_t fault_index, double prob,
+                            double p) {
+    FLIPIT_InjectionCount++;
+    FLIPIT_REMAIN_INJECT_COUNT--;
+    if (FLIPIT_REMAIN_INJECT_COUNT == 0) FLIPIT_RankInject = 0; 
+
+    flipit_print_injectedErr(type, bPos, fault_index, prob, p);
+    flipit_taintInjected(fault_index);
+    flipit_telemetryInjected(fault_index);
+    flipit_crashInjected(fault_index);
+    FLIPIT_Attempts = 0;
+}
+
 static double flipit_countdown() {
     return (double) --FLIPIT_InjCountdown;
 }
@@ -355,6 +653,30 @@ static void flipit_countdownLogger(FILE* outfile) {
     FLIPIT_InjCountdown = FLIPIT_Attempts;
 }
 
+/* number of sites from FLIPIT_SiteBase to the last site of the module numbered like it in the
+   site tables, read in place; 0 without site tables. The linker may pad between the tables of
+   two objects, so anything that is not a table is skipped 8 bytes at a time */
+static uint64_t flipit_siteTableCount() {
+    const char* p = __start_flipit_sites;
+    uint64_t count = 0;
+
+    if (__start_flipit_sites == NULL || __stop_flipit_sites == NULL)
+        return 0;
+    while (p + sizeof(FLIPIT_SiteTable) <= __stop_flipit_sites) {
+        const FLIPIT_SiteTable* t = (const FLIPIT_SiteTable*) p;
+        if (t->magic != FLIPIT_SITES_MAGIC || t->size < sizeof(FLIPIT_SiteTable)) {
+            p += 8;
+            continue;
+        }
+        if (t->version == FLIPIT_SITES_VERSION && t->firstSite >= FLIPIT_SiteBase
+            && t->firstSite >> 32 == FLIPIT_SiteBase >> 32
+            && t->firstSite + t->numSites - FLIPIT_SiteBase > count)
+            count = t->firstSite + t->numSites - FLIPIT_SiteBase;
+        p += t->size;
+    }
+    return count;
+}
+
 /***********************************************************************************************/
 /* The functions below this are inserted by the compiler pass to flip a bit                    */
 /***********************************************************************************************/
@@ -365,13 +687,16 @@ uint64_t corruptIntData_64bit(uint32_t parameter, double prob, uint64_t inst_dat
 #ifdef FLIPIT_HISTOGRAM
     // extract fault_index, byte_val from parameter
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
-    FLIPIT_Histogram[fault_index]++;
+    FLIPIT_HISTOGRAM_SITE(fault_index);
 #endif
+    FLIPIT_TELEMETRY_SITE();
+    FLIPIT_NULL_RETURN(inst_data);
 
     // verify that it is the correct time to inject
     if (0 == flipit_shouldInjectNoCheck()) return inst_data;
     float p = FLIPIT_FaultProb();
     if (p > prob) return inst_data;
+    if (flipit_planActive()) return inst_data;
 #ifndef FLIPIT_HISTOGRAM
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
 #endif
@@ -386,12 +711,7 @@ uint64_t corruptIntData_64bit(uint32_t parameter, double prob, uint64_t inst_dat
     if (byte > 7) byte = rand() % (16 - byte); 
 
     //printf("Byte = %d, Bit = %d\n", byte, bit);            
-    FLIPIT_InjectionCount++;
-    FLIPIT_REMAIN_INJECT_COUNT--;
-    if (FLIPIT_REMAIN_INJECT_COUNT == 0) FLIPIT_RankInject = 0; 
-    
-    flipit_print_injectedErr("Integer Data", byte*8 + bit, fault_index, prob, p);
-    FLIPIT_Attempts = 0;
+    flipit_injected("Integer Data", byte*8 + bit, fault_index, prob, p);
     return inst_data ^ ((uint64_t) 0x1L << (byte*8 + bit)); //TODO: correctly wrap for 32, 16, and 8 bit integers
 }
 
@@ -402,13 +722,16 @@ float corruptFloatData_32bit(uint32_t parameter, double prob, float inst_data)
 #ifdef FLIPIT_HISTOGRAM
     // extract fault_index, byte_val from parameter
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
-    FLIPIT_Histogram[fault_index]++;
+    FLIPIT_HISTOGRAM_SITE(fault_index);
 #endif
+    FLIPIT_TELEMETRY_SITE();
+    FLIPIT_NULL_RETURN(inst_data);
 
     //TODO: add support for CHECK()
     if (0 == flipit_shouldInjectNoCheck()) return inst_data;
     float p = FLIPIT_FaultProb();
     if (p > prob) return inst_data;
+    if (flipit_planActive()) return inst_data;
 #ifndef FLIPIT_HISTOGRAM
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
 #endif
@@ -428,12 +751,7 @@ float corruptFloatData_32bit(uint32_t parameter, double prob, float inst_data)
     else
         byte = byte % 4; // wrap fixed byte to sizeof(float) 
             
-    FLIPIT_InjectionCount++;
-    FLIPIT_REMAIN_INJECT_COUNT--;
-    if (FLIPIT_REMAIN_INJECT_COUNT == 0) FLIPIT_RankInject = 0; 
-    
-    flipit_print_injectedErr("32-bit IEEE Float Data", byte*8 + bit, fault_index, prob, p);
-    FLIPIT_Attempts = 0;
+    flipit_injected("32-bit IEEE Float Data", byte*8 + bit, fault_index, prob, p);
     
     int* ptr = (int* ) &inst_data;
     int tmp  = (*ptr ^ (0x1 << (bit + byte * 8)));
@@ -448,13 +766,16 @@ double corruptFloatData_64bit(uint32_t parameter, double prob, double inst_data)
 #ifdef FLIPIT_HISTOGRAM
     // extract fault_index, byte_val from parameter
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
-    FLIPIT_Histogram[fault_index]++;
+    FLIPIT_HISTOGRAM_SITE(fault_index);
 #endif
+    FLIPIT_TELEMETRY_SITE();
+    FLIPIT_NULL_RETURN(inst_data);
 
     //TODO: add support for CHECK()
     if (0 == flipit_shouldInjectNoCheck()) return inst_data;
     float p = FLIPIT_FaultProb();
     if (p > prob) return inst_data;
+    if (flipit_planActive()) return inst_data;
 #ifndef FLIPIT_HISTOGRAM
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
 #endif
@@ -469,12 +790,7 @@ double corruptFloatData_64bit(uint32_t parameter, double prob, double inst_data)
     if (byte > 7)
         byte = rand() % 8;
             
-    FLIPIT_InjectionCount++;
-    FLIPIT_REMAIN_INJECT_COUNT--;
-    if (FLIPIT_REMAIN_INJECT_COUNT == 0) FLIPIT_RankInject = 0; 
-    
-    flipit_print_injectedErr("64-bit IEEE Float Data", byte*8 + bit, fault_index, prob, p);
-    FLIPIT_Attempts = 0;
+    flipit_injected("64-bit IEEE Float Data", byte*8 + bit, fault_index, prob, p);
     
 	long long* ptr = (long long* ) &inst_data;
     long long tmp  = (*ptr ^ (0x1L << (byte*8 + bit)));
@@ -488,13 +804,16 @@ uint64_t corruptPtr2Int_64bit(uint32_t parameter, double prob, uint64_t inst_dat
 #ifdef FLIPIT_HISTOGRAM
     // extract fault_index, byte_val from parameter
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
-    FLIPIT_Histogram[fault_index]++;
+    FLIPIT_HISTOGRAM_SITE(fault_index);
 #endif
+    FLIPIT_TELEMETRY_SITE();
+    FLIPIT_NULL_RETURN(inst_data);
 
     //TODO: add support for CHECK()
     if (0 == flipit_shouldInjectNoCheck()) return inst_data;
     float p = FLIPIT_FaultProb();
     if (p > prob) return inst_data;
+    if (flipit_planActive()) return inst_data;
 #ifndef FLIPIT_HISTOGRAM
     uint32_t fault_index = (uint32_t) (parameter & FAULT_IDX_MASK);
 #endif
@@ -508,13 +827,140 @@ uint64_t corruptPtr2Int_64bit(uint32_t parameter, double prob, uint64_t inst_dat
     if (bit == 0xF) bit = rand() % 8; //get correct bit
     if (byte > 7) byte = rand() % 8; 
             
-    FLIPIT_InjectionCount++;
-    FLIPIT_REMAIN_INJECT_COUNT--;
-    if (FLIPIT_REMAIN_INJECT_COUNT == 0) FLIPIT_RankInject = 0; 
-    
-    flipit_print_injectedErr("Converted Pointer", byte*8 + bit, fault_index, prob, p);
-    FLIPIT_Attempts = 0;
+    flipit_injected("Converted Pointer", byte*8 + bit, fault_index, prob, p);
     return inst_data ^ ((uint64_t) 0x1L << (byte*8 + bit)); 
 }
 
+/***********************************************************************************************/
+/* Specialized versions of the functions above. The compiler pass knows at compile time        */
+/* whether the byte and bit to flip are fixed (-byte/-bit) and how wide the value is, so it    */
+/* calls the version for that case with the 64-bit site index and the constant bit position    */
+/* (fixed), byte (fixedByte), or bit (fixedBit) in pos and the width of the value in bytes.    */
+/* Nothing is decoded on the hot path and only the random bits that are needed are drawn.      */
+/***********************************************************************************************/
+
+#define FLIPIT_CORRUPT_ENTRY(name, T, U, label, BITPOS)                                        \
+T name(uint64_t site, double prob, T inst_data, uint32_t pos, uint32_t width)                  \
+{                                                                                              \
+    U bits;                                                                                    \
+    uint32_t bPos;                                                                             \
+    double p;                                                                                  \
+    FLIPIT_COUNT_SITE(site);                                                                   \
+    FLIPIT_NULL_RETURN(inst_data);                                                             \
+    if (FLIPIT_PlanLeft > 0) {                                                                 \
+        FLIPIT_TotalInsts++;                                                                   \
+        bPos = flipit_planHit(site, width*8);                                                  \
+        if (bPos == FLIPIT_PLAN_MISS) return inst_data;                                        \
+        p = prob;                                                                              \
+    } else {                                                                                   \
+        if (0 == flipit_shouldInjectNoCheck()) return inst_data;                               \
+        p = FLIPIT_FaultProb();                                                                \
+        if (p > prob) return inst_data;                                                        \
+        if (flipit_planActive()) return inst_data;                                             \
+        if (FLIPIT_RANGE_MISS()) return inst_data;                                             \
+        if (0 == flipit_checkActiveFaultSite(site)) return inst_data;                          \
+        bPos = (BITPOS);                                                                       \
+    }                                                                                          \
+    flipit_injected(label, bPos, site, prob, p);                                               \
+    memcpy(&bits, &inst_data, sizeof(T));                                                      \
+    bits ^= (U) 0x1 << bPos;                                                                   \
+    memcpy(&inst_data, &bits, sizeof(T));                                                      \
+    return inst_data;                                                                          \
+}
+
+#define FLIPIT_CORRUPT_ENTRIES(type, T, U, label)                                              \
+    FLIPIT_CORRUPT_ENTRY(corrupt##type##_fixed, T, U, label, pos)                              \
+    FLIPIT_CORRUPT_ENTRY(corrupt##type##_fixedByte, T, U, label, pos*8 + rand() % 8)           \
+    FLIPIT_CORRUPT_ENTRY(corrupt##type##_fixedBit, T, U, label, (rand() % width)*8 + pos)      \
+    FLIPIT_CORRUPT_ENTRY(corrupt##type##_random, T, U, label, rand() % (width*8))
+
+FLIPIT_CORRUPT_ENTRIES(IntData_64bit, uint64_t, uint64_t, "Integer Data")
+FLIPIT_CORRUPT_ENTRIES(FloatData_32bit, float, uint32_t, "32-bit IEEE Float Data")
+FLIPIT_CORRUPT_ENTRIES(FloatData_64bit, double, uint64_t, "64-bit IEEE Float Data")
+FLIPIT_CORRUPT_ENTRIES(Ptr2Int_64bit, uint64_t, uint64_t, "Converted Pointer")
+
+/***********************************************************************************************/
+/* Inline mask instrumentation (compiled with -inlineMask). The pass does not call into the    */
+/* runtime at the sites; an instrumented function calls flipit_inlineArm once on entry and     */
+/* XORs every site it executes with a mask that is zero unless that site is the one returned.  */
+/* The armed site is disarmed by its first execution, so it is corrupted once like a call      */
+/* site, but the probability, countdown, and budget count function invocations rather than     */
+/* site executions, and an armed site that does not run in that invocation injects nothing.    */
+/* A plan names site executions, which this build does not count, so it is refused with a      */
+/* warning. The bit logged is the one the site flips, worked out from its layout word.         */
+/***********************************************************************************************/
 
+uint64_t FLIPIT_InlineBits = 0;
+static int FLIPIT_InlinePlanWarned = 0;
+
+uint64_t flipit_inlineArm(uint64_t firstSite, uint32_t numSites, double prob,
+                          const uint32_t* layout)
+{
+    uint64_t site, width, pos;
+    uint32_t bitPos;
+    double p;
+
+    FLIPIT_NULL_RETURN(FLIPIT_INLINE_NONE);
+    if (flipit_planActive()) {
+        if (!FLIPIT_InlinePlanWarned)
+            printf("Warning: FlipIt cannot follow a plan in code compiled with -inlineMask; "
+                   "its sites get no faults\n");
+        FLIPIT_InlinePlanWarned = 1;
+        return FLIPIT_INLINE_NONE;
+    }
+    if (0 == flipit_shouldInjectNoCheck()) return FLIPIT_INLINE_NONE;
+    p = FLIPIT_FaultProb();
+    if (p > prob) return FLIPIT_INLINE_NONE;
+    site = firstSite + rand() % numSites;
+    if (0 == flipit_checkActiveFaultSite(site)) return FLIPIT_INLINE_NONE;
+
+    /* the site reduces the bits to a position within the width of its value */
+    FLIPIT_InlineBits = ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+    width = (layout[site - firstSite] >> 8) & 0xFF;
+    pos = layout[site - firstSite] & 0xFF;
+    if (width == 0) width = 8;
+    switch (layout[site - firstSite] >> 16) {
+        case FLIPIT_INLINE_FIXED:
+            bitPos = pos;
+            break;
+        case FLIPIT_INLINE_FIXED_BYTE:
+            bitPos = pos*8 + (FLIPIT_InlineBits & 7);
+            break;
+        case FLIPIT_INLINE_FIXED_BIT:
+            bitPos = (FLIPIT_InlineBits % width)*8 + pos;
+            break;
+        default:
+            bitPos = FLIPIT_InlineBits % (width*8);
+    }
+    flipit_injected("Inline Mask", bitPos, site, prob, p);
+    return site;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int64_t corruptPayloadBit(uint64_t site, double prob, uint64_t nbytes, char* type)
+{
+    // MPI call sites are numbered in module FLIPIT_MPI_SITE_MODULE (mpi_corrupt.c)
+    FLIPIT_COUNT_SITE(site);
+
+    FLIPIT_NULL_RETURN(-1);
+    if (nbytes == 0) return -1;
+    if (FLIPIT_PlanLeft > 0) {
+        FLIPIT_TotalInsts++;
+        uint32_t bPos = flipit_planHit(site, nbytes*8 < UINT32_MAX ? nbytes*8 : UINT32_MAX - 1);
+        if (bPos == FLIPIT_PLAN_MISS) return -1;
+        flipit_injected(type, bPos, site, prob, prob);
+        return bPos;
+    }
+    if (0 == flipit_shouldInjectNoCheck()) return -1;
+    float p = FLIPIT_FaultProb();
+    if (p > prob) return -1;
+    if (flipit_planActive()) return -1;
+    if (0 == flipit_checkActiveFaultSite(site)) return -1;
+
+    // any bit of the payload is fair game
+    char bit = rand() % 8;
+    uint64_t byte = (((uint64_t) rand() << 31) | (uint64_t) rand()) % nbytes;
+
+    flipit_injected(type, byte*8 + bit, site, prob, p);
+    return (int64_t) (byte*8 + bit);
+}
@@ -35,6 +35,166 @@ extern "C" {
 #define FLIPIT_ON 1
 #define FLIPIT_OFF 0
 
+/* site index in the packed parameter of the original corrupt functions. The compiler pass now
+   calls the specialized versions, which take the full 64-bit site index */
+#define FAULT_IDX_MASK 0x00FFFFFF
+
+/* which direction of MPI message payloads to corrupt (mpi_corrupt.c) */
+#define FLIPIT_PAYLOAD_OFF  0
+#define FLIPIT_PAYLOAD_SEND 1
+#define FLIPIT_PAYLOAD_RECV 2
+#define FLIPIT_PAYLOAD_BOTH (FLIPIT_PAYLOAD_SEND | FLIPIT_PAYLOAD_RECV)
+
+/* MPI payload sites are numbered in this module (the upper 32 bits of the site index, see
+   -siteModule), by a hash of the calling object, the call's offset in it, and the direction */
+#define FLIPIT_MPI_SITE_MODULE 0xFFFFFFFFU
+
+/* element types understood by FLIPIT_CompareBuffers (compare.c) */
+#define FLIPIT_FLOAT  0
+#define FLIPIT_DOUBLE 1
+#define FLIPIT_INT8   2
+#define FLIPIT_INT16  3
+#define FLIPIT_INT32  4
+#define FLIPIT_INT64  5
+
+/* persistent trial loop (trial.c) */
+#define FLIPIT_TRIAL_COMPLETED 0
+#define FLIPIT_TRIAL_CRASHED   1
+#define FLIPIT_TRIAL_MASKED    2
+#define FLIPIT_TRIAL_INPROCESS 0
+#define FLIPIT_TRIAL_FORK      1
+
+/* what FLIPIT_Checkpoint found (checkpoint.c) */
+#define FLIPIT_STATE_UNKNOWN  0     /* no golden hash for this checkpoint */
+#define FLIPIT_STATE_RECORDED 1     /* golden run: the hash was written */
+#define FLIPIT_STATE_GOLDEN   2     /* same as the golden run, nothing injected yet */
+#define FLIPIT_STATE_DIVERGED 3     /* differs from the golden run */
+#define FLIPIT_STATE_MASKED   4     /* same as the golden run after the injection */
+
+/* campaign plan file (--plan, plan.c): a FLIPIT_PlanHeader followed by count entries sorted by
+   trial. A fault fires on the instance-th execution (counting from 1) of its site on its rank,
+   or of any site with FLIPIT_PLAN_ANY_SITE, and flips bit modulo the width of the value. The
+   runtime counts the executions of all threads together: thread must be 0 or ANY */
+#define FLIPIT_PLAN_MAGIC      0x314e414c50544946ULL    /* "FITPLAN1" */
+#define FLIPIT_PLAN_ANY_SITE   UINT64_MAX
+#define FLIPIT_PLAN_ANY_THREAD UINT32_MAX
+
+typedef struct {
+    uint64_t magic;
+    uint64_t count;
+} FLIPIT_PlanHeader;
+
+typedef struct {
+    uint64_t trial;
+    uint32_t rank;
+    uint32_t thread;
+    uint64_t site;
+    uint64_t instance;
+    uint32_t bit;
+    uint32_t reserved;
+} FLIPIT_PlanEntry;
+
+/* live telemetry page (--telemetry <name>, telemetry.c): the shared memory object /<name>_<rank>
+   holds a FLIPIT_Telemetry, one cache line of header and one per thread. A reader checks magic
+   and version, then reads active lines; heartbeat is CLOCK_REALTIME in ns and lastSite is
+   UINT64_MAX until the thread injects. Lines are rewritten every FLIPIT_TELEMETRY_BATCH site
+   executions of their thread and on every injection */
+#define FLIPIT_TELEMETRY_MAGIC    0x4d454c4554544946ULL    /* "FITTELEM" */
+#define FLIPIT_TELEMETRY_VERSION  1
+#define FLIPIT_TELEMETRY_SLOTS    64
+#define FLIPIT_TELEMETRY_BATCH    65536
+#define FLIPIT_TELEMETRY_RUNNING  1
+#define FLIPIT_TELEMETRY_FINISHED 2
+
+typedef struct {
+    uint64_t tid;
+    uint64_t sites;         /* fault site executions */
+    uint64_t attempts;      /* sites that drew for an injection */
+    uint64_t injections;
+    uint64_t lastSite;
+    uint64_t heartbeat;
+    uint64_t reserved[2];
+} __attribute__((aligned(64))) FLIPIT_TelemetryThread;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t size;          /* sizeof(FLIPIT_Telemetry) */
+    int32_t  pid;
+    uint32_t rank;
+    uint32_t slots;
+    uint32_t active;        /* thread lines in use */
+    uint64_t start;         /* CLOCK_REALTIME in ns */
+    uint32_t state;
+    uint32_t pad;
+    uint64_t numSites;
+    uint64_t reserved;
+    FLIPIT_TelemetryThread thread[FLIPIT_TELEMETRY_SLOTS];
+} __attribute__((aligned(64))) FLIPIT_Telemetry;
+
+/* crash record (--crashRecord <name>, crash.c): the handler of SIGSEGV, SIGBUS, SIGFPE, SIGILL,
+   and SIGABRT writes one FLIPIT_CrashRecord to <name>_<rank>, opened by FLIPIT_Init, and exits
+   with 128 + signal. addr is si_addr, pc the interrupted instruction (0 where unknown), lastSite
+   UINT64_MAX until the process injects, and frame the raw return addresses of the handler's
+   backtrace. FLIPIT_Finalize removes the file of a process that did not crash */
+#define FLIPIT_CRASH_MAGIC   0x4853415243544946ULL    /* "FITCRASH" */
+#define FLIPIT_CRASH_VERSION 1
+#define FLIPIT_CRASH_FRAMES  16
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rank;
+    int32_t  signal;
+    int32_t  code;          /* si_code */
+    uint64_t addr;
+    uint64_t pc;
+    uint64_t lastSite;
+    uint64_t injections;
+    uint64_t executions;    /* fault site executions */
+    uint64_t sinceInjection;/* fault site executions since the last injection */
+    uint32_t frames;
+    uint32_t reserved;
+    uint64_t frame[FLIPIT_CRASH_FRAMES];
+} FLIPIT_CrashRecord;
+
+/* site table (flipit_sites section): the pass puts one FLIPIT_SiteTable per instrumented module
+   into the section, followed by its numSites FLIPIT_SiteEntry in site order and its numStrings
+   NUL terminated strings, with size bytes in all (a multiple of 8). String 0 is the source file
+   of the module, file and function index the strings. FLIPIT_Init takes the number of sites
+   from the tables of an executable linked with them instead of reading the state file */
+#define FLIPIT_SITES_MAGIC   0x5345544953544946ULL    /* "FITSITES" */
+#define FLIPIT_SITES_VERSION 1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint64_t firstSite;
+    uint32_t numSites;
+    uint32_t numStrings;
+} FLIPIT_SiteTable;
+
+typedef struct {
+    uint32_t line;
+    uint16_t file;
+    uint16_t function;
+    uint8_t  opcode;
+    uint8_t  typeInfo;      /* injection type << 5 | info, as in the LLVM log file */
+    uint16_t reserved;
+    uint32_t classOffset;   /* site - representative of its def-use class */
+    float    weight;        /* static executions per invocation of the function */
+} FLIPIT_SiteEntry;
+
+typedef struct {
+    uint64_t mismatches;    /* elements outside of both the relative and ULP tolerance */
+    int64_t  firstIndex;    /* first mismatching element, -1 if none */
+    double   maxAbsError;
+    double   maxRelError;
+    uint64_t maxULPError;   /* integer types: absolute difference */
+    uint64_t checksum;      /* FLIPIT_Checksum of the output buffer */
+} FLIPIT_CompareResult;
+
 
 /* setting up and house keeping */
 void FLIPIT_Init(uint32_t myRank, uint32_t argc, char** argv, uint64_t seed);
@@ -48,6 +208,38 @@ unsigned long long FLIPIT_GetExecutedInstructionCount();
 int FLIPIT_GetInjectionCount();
 void FLIPIT_SetMaxInjections(int n);
 int FLIPIT_GetMaxInjections();
+uint64_t FLIPIT_GetSiteCount();
+void FLIPIT_SetPayloadInjection(int mode, double prob);
+int FLIPIT_GetPayloadInjection(double* prob);
+void FLIPIT_SetTaintTracking(int state);
+uint64_t FLIPIT_GetTaintedBytes();
+
+/* checking results against a golden copy */
+uint64_t FLIPIT_CompareBuffers(const void* out, const void* golden, uint64_t n, int type,
+                               double relTol, uint64_t ulpTol, FLIPIT_CompareResult* res);
+uint64_t FLIPIT_Checksum(const void* buf, uint64_t nbytes);
+uint64_t FLIPIT_TypeSize(int type);
+
+/* many trials in one process; each emits one trial record */
+void FLIPIT_TrialBegin(uint64_t seed);
+int FLIPIT_TrialEnd();
+int FLIPIT_RunTrial(uint64_t seed, void (*trial)(void*), void* arg);
+void FLIPIT_SetTrialIsolation(int mode);
+
+/* ending masked trials early by hashing the application state against the golden run. A masked
+   trial returns FLIPIT_STATE_MASKED for the application to end on; FLIPIT_SetCheckpointExit(
+   FLIPIT_ON) has FlipIt finalize and exit instead, which only suits a single process, since an
+   MPI rank that exits alone hangs the others. The exit does not write the site histogram */
+int FLIPIT_RegisterState(const void* buf, uint64_t nbytes);
+void FLIPIT_UnregisterState(const void* buf);
+int FLIPIT_Checkpoint();
+void FLIPIT_SetCheckpointExit(int state);
+
+/* targeting the values loaded from and stored to address ranges, e.g. the matrix of a solver.
+   Only code compiled with -rangeCheck looks at them, and it injects nothing while no range is
+   registered */
+int FLIPIT_RegisterRange(const void* buf, uint64_t nbytes);
+void FLIPIT_UnregisterRange(const void* buf);
 
 /* FORTRAN VERSIONS (ex: CALL flipit_init_ftn(myrank, argc, argv, seed) */
 int flipit_init_ftn_(int* myRank, int* argc, char*** argv, unsigned long long* seed);
@@ -63,6 +255,78 @@ float      corruptFloatData_32bit (uint32_t parameter, double prob, float inst_d
 uint64_t corruptIntData_64bit   (uint32_t parameter, double prob, uint64_t inst_data);
 double     corruptFloatData_64bit (uint32_t parameter, double prob, double inst_data);
 uint64_t corruptPtr2Int_64bit   (uint32_t parameter, double prob, uint64_t inst_data);
+
+/* specialized versions chosen by the compiler pass when the byte/bit are known at compile time.
+   pos is the bit position (_fixed), byte (_fixedByte), or bit (_fixedBit); width is in bytes */
+uint64_t corruptIntData_64bit_fixed       (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptIntData_64bit_fixedByte   (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptIntData_64bit_fixedBit    (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptIntData_64bit_random      (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+float    corruptFloatData_32bit_fixed     (uint64_t site, double prob, float inst_data,
+                                           uint32_t pos, uint32_t width);
+float    corruptFloatData_32bit_fixedByte (uint64_t site, double prob, float inst_data,
+                                           uint32_t pos, uint32_t width);
+float    corruptFloatData_32bit_fixedBit  (uint64_t site, double prob, float inst_data,
+                                           uint32_t pos, uint32_t width);
+float    corruptFloatData_32bit_random    (uint64_t site, double prob, float inst_data,
+                                           uint32_t pos, uint32_t width);
+double   corruptFloatData_64bit_fixed     (uint64_t site, double prob, double inst_data,
+                                           uint32_t pos, uint32_t width);
+double   corruptFloatData_64bit_fixedByte (uint64_t site, double prob, double inst_data,
+                                           uint32_t pos, uint32_t width);
+double   corruptFloatData_64bit_fixedBit  (uint64_t site, double prob, double inst_data,
+                                           uint32_t pos, uint32_t width);
+double   corruptFloatData_64bit_random    (uint64_t site, double prob, double inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptPtr2Int_64bit_fixed       (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptPtr2Int_64bit_fixedByte   (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptPtr2Int_64bit_fixedBit    (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+uint64_t corruptPtr2Int_64bit_random      (uint64_t site, double prob, uint64_t inst_data,
+                                           uint32_t pos, uint32_t width);
+
+/* zero only in the null shared runtime; code compiled with -armedGuard skips every call into
+   the runtime while it is zero */
+extern int32_t FLIPIT_Armed;
+
+/* range checks inlined by -rangeCheck: a site calls into the runtime only if its address minus
+   FLIPIT_RangeInline[2i] is below FLIPIT_RangeInline[2i + 1] for i = 0 or 1, with the address in
+   FLIPIT_RangeAddr for the duration of the call. FLIPIT_RangeSearch is set when the intervals
+   are only the hull of the ranges and the runtime looks the address up itself (range.c) */
+extern uint64_t FLIPIT_RangeInline[4];
+extern __thread uint64_t FLIPIT_RangeAddr;
+extern int FLIPIT_RangeSearch;
+
+/* inline mask instrumentation (-inlineMask): called once on entry to an instrumented function
+   with its sites; returns the site to corrupt during this invocation or FLIPIT_INLINE_NONE.
+   layout holds one word per site, mode << 16 | width << 8 | pos, telling how the site turns
+   FLIPIT_InlineBits into the bit it flips */
+#define FLIPIT_INLINE_NONE UINT64_MAX
+#define FLIPIT_INLINE_RANDOM     0
+#define FLIPIT_INLINE_FIXED      1
+#define FLIPIT_INLINE_FIXED_BYTE 2
+#define FLIPIT_INLINE_FIXED_BIT  3
+extern uint64_t FLIPIT_InlineBits;
+uint64_t flipit_inlineArm(uint64_t firstSite, uint32_t numSites, double prob,
+                          const uint32_t* layout);
+
+/* corrupt a message payload of nbytes (called by the MPI interception layer). Returns the bit
+   position inside the payload to flip or -1 if we are not to inject */
+int64_t  corruptPayloadBit      (uint64_t site, double prob, uint64_t nbytes, char* type);
+
+/* shadow memory of the corruption tracking clones (compiled with -taint) */
+uint8_t flipit_taintLoad      (void* addr, uint64_t size);
+void    flipit_taintStore     (void* addr, uint64_t size, uint8_t taint);
+void    flipit_taintCopy      (void* dst, void* src, uint64_t size);
+void    flipit_taintSeedStore (void* addr, uint64_t size);
+void    flipit_taintSite      (uint64_t site, uint8_t taint);
+void    flipit_taintUntracked (uint64_t site);
 #endif
 
 #ifdef __cplusplus
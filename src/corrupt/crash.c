@@ -0,0 +1,147 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: crash.c                                                                               */
+/*                                                                                             */
+/* Description: Binary crash record (--crashRecord <name>). FLIPIT_Init opens <name>_<rank>   */
+/*              and installs a handler for the fatal signals that fills a FLIPIT_CrashRecord  */
+/*              on its stack, writes it with one write() to the open descriptor, and leaves   */
+/*              with _exit(): no malloc, no stdio, and no core dump, so a crashing trial ends  */
+/*              at once and the campaign reads its outcome without parsing any text. Whatever */
+/*              the process still had buffered in stdio is lost, the record is not.           */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#define _GNU_SOURCE
+#include <execinfo.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <ucontext.h>
+#include "runtime.h"
+
+#define FLIPIT_CRASH_STACK_SIZE (64*1024)
+
+static const int FLIPIT_CrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define FLIPIT_NUM_CRASH_SIGNALS (sizeof(FLIPIT_CrashSignals) / sizeof(int))
+
+static int FLIPIT_CrashFd = -1;
+static char FLIPIT_CrashFile[500];
+static struct sigaction FLIPIT_CrashOldActions[FLIPIT_NUM_CRASH_SIGNALS];
+static int FLIPIT_CrashHandlers = 0;
+static volatile int FLIPIT_CrashWriting = 0;
+static volatile uint64_t FLIPIT_CrashLastSite = UINT64_MAX;
+static volatile uint64_t FLIPIT_CrashInjectedAt = 0;
+
+static void flipit_crashHandler(int sig, siginfo_t* info, void* context);
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+void flipit_crashInit(char* name, uint32_t rank) {
+    struct sigaction action;
+    stack_t stack;
+    void* warm[2];
+    uint32_t i;
+
+    if (name == NULL || FLIPIT_CrashFd >= 0)
+        return;
+    snprintf(FLIPIT_CrashFile, sizeof(FLIPIT_CrashFile), "%s_%u", name, rank);
+    FLIPIT_CrashFd = open(FLIPIT_CrashFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (FLIPIT_CrashFd < 0) {
+        printf("Warning: FlipIt cannot open the crash record %s\n", FLIPIT_CrashFile);
+        return;
+    }
+
+    /* the first backtrace() loads the unwinder, which may allocate; do it now, not in the
+       handler */
+    backtrace(warm, 2);
+    if (FLIPIT_CrashHandlers)
+        return;
+
+    /* a stack overflow needs a stack of its own to report it */
+    stack.ss_sp = malloc(FLIPIT_CRASH_STACK_SIZE);
+    stack.ss_size = FLIPIT_CRASH_STACK_SIZE;
+    stack.ss_flags = 0;
+    if (stack.ss_sp != NULL)
+        sigaltstack(&stack, NULL);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = flipit_crashHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (i = 0; i < FLIPIT_NUM_CRASH_SIGNALS; i++)
+        sigaction(FLIPIT_CrashSignals[i], &action, &FLIPIT_CrashOldActions[i]);
+    FLIPIT_CrashHandlers = 1;
+}
+
+void flipit_crashInjected(uint64_t site) {
+    FLIPIT_CrashLastSite = site;
+    FLIPIT_CrashInjectedAt = FLIPIT_GetExecutedInstructionCount();
+}
+
+/* nothing crashed: the empty record goes away. The handlers stay and hand every signal back
+   to the handler that was there before */
+void flipit_crashFinalize() {
+    int fd = FLIPIT_CrashFd;
+    if (fd < 0)
+        return;
+    FLIPIT_CrashFd = -1;
+    close(fd);
+    unlink(FLIPIT_CrashFile);
+}
+
+/* async-signal-safe: only the stack, write(), and _exit() */
+static void flipit_crashHandler(int sig, siginfo_t* info, void* context) {
+    FLIPIT_CrashRecord rec;
+    void* frames[FLIPIT_CRASH_FRAMES];
+    const char* buf = (const char*) &rec;
+    size_t left = sizeof(rec);
+    uint32_t i;
+
+    /* no record to write, or another thread is writing one */
+    if (FLIPIT_CrashFd < 0 || __atomic_exchange_n(&FLIPIT_CrashWriting, 1, __ATOMIC_ACQ_REL)) {
+        if (FLIPIT_CrashFd >= 0)
+            for (;;)
+                pause();
+        for (i = 0; i < FLIPIT_NUM_CRASH_SIGNALS; i++)
+            if (FLIPIT_CrashSignals[i] == sig)
+                sigaction(sig, &FLIPIT_CrashOldActions[i], NULL);
+        raise(sig);
+        return;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = FLIPIT_CRASH_MAGIC;
+    rec.version = FLIPIT_CRASH_VERSION;
+    rec.rank = flipit_getRank();
+    rec.signal = sig;
+    rec.code = info->si_code;
+    rec.addr = (uint64_t) (uintptr_t) info->si_addr;
+#if defined(__linux__) && defined(__x86_64__)
+    rec.pc = (uint64_t) ((ucontext_t*) context)->uc_mcontext.gregs[REG_RIP];
+#elif defined(__linux__) && defined(__aarch64__)
+    rec.pc = (uint64_t) ((ucontext_t*) context)->uc_mcontext.pc;
+#endif
+    rec.lastSite = FLIPIT_CrashLastSite;
+    rec.injections = FLIPIT_GetInjectionCount();
+    rec.executions = FLIPIT_GetExecutedInstructionCount();
+    if (rec.lastSite != UINT64_MAX)
+        rec.sinceInjection = rec.executions - FLIPIT_CrashInjectedAt;
+    rec.frames = backtrace(frames, FLIPIT_CRASH_FRAMES);
+    for (i = 0; i < rec.frames; i++)
+        rec.frame[i] = (uint64_t) (uintptr_t) frames[i];
+
+    while (left > 0) {
+        ssize_t n = write(FLIPIT_CrashFd, buf, left);
+        if (n <= 0)
+            break;
+        buf += n;
+        left -= n;
+    }
+    _exit(128 + sig);
+}
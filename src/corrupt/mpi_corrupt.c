@@ -0,0 +1,562 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: mpi_corrupt.c                                                                         */
+/*                                                                                             */
+/* Description: PMPI interception layer that corrupts (single bit-flip) the payload of MPI     */
+/*              messages. Every call of an MPI function in the application, and each direction */
+/*              of it (e.g. the send and receive half of MPI_Sendrecv), is a fault site in     */
+/*              module FLIPIT_MPI_SITE_MODULE, numbered from the calling object's name and the */
+/*              call's offset in it, so it is the same on every rank and in every run of the   */
+/*              same build. The decision to inject uses the same probability, budget, and      */
+/*              fault site filter as the functions in corrupt.c. When we are not to inject,    */
+/*              the user's buffers are handed to MPI untouched.                                */
+/*                                                                                             */
+/*              It also coordinates the injections of all ranks of the job (FLIPIT_Init on     */
+/*              every rank sets it up, see flipit_jobInit):                                    */
+/*                                                                                             */
+/*                  --jobFaults <n>  (-jF)  at most n faults in the whole job                  */
+/*                  --jobProfile <p> (-jP)  place the faults with the histograms p_<rank>      */
+/*                                                                                             */
+/*              The budget is one counter on rank 0 that a rank about to inject decrements     */
+/*              with an MPI atomic. The ranks of a node share a flag in node-local shared      */
+/*              memory that stops them from asking once the budget is gone. Only injections    */
+/*              touch either. With a profile, rank 0 draws every fault uniformly from all the  */
+/*              site executions of all ranks: a rank in proportion to its count and one of its */
+/*              executions, which that rank counts down to. Every other rank never injects.    */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <mpi.h>
+#include "runtime.h"
+
+/* the wrapper and direction of a payload site, hashed into its index along with the caller */
+enum {
+    FLIPIT_MPI_SEND = 0,
+    FLIPIT_MPI_RECV,
+    FLIPIT_MPI_SENDRECV_SEND,
+    FLIPIT_MPI_SENDRECV_RECV,
+    FLIPIT_MPI_BCAST_ROOT,
+    FLIPIT_MPI_BCAST_RECV,
+    FLIPIT_MPI_REDUCE_SEND,
+    FLIPIT_MPI_REDUCE_ROOT,
+    FLIPIT_MPI_ALLREDUCE_SEND,
+    FLIPIT_MPI_ALLREDUCE_RECV,
+    FLIPIT_NUM_MPI_SITES
+};
+
+static char* FLIPIT_MPISiteLabel[FLIPIT_NUM_MPI_SITES] = {
+    "MPI_Send Payload", "MPI_Recv Payload", "MPI_Sendrecv Send Payload",
+    "MPI_Sendrecv Recv Payload", "MPI_Bcast Root Payload", "MPI_Bcast Payload",
+    "MPI_Reduce Send Payload", "MPI_Reduce Root Payload", "MPI_Allreduce Send Payload",
+    "MPI_Allreduce Payload"
+};
+
+/* shared by the ranks of a node */
+typedef struct {
+    int32_t exhausted;      /* the job's budget is used up */
+    int32_t lock;           /* one claim of the node at a time goes to rank 0 */
+    uint64_t injected;      /* faults injected on this node */
+} FLIPIT_JobNode;
+
+static MPI_Win FLIPIT_JobWin = MPI_WIN_NULL;
+static MPI_Win FLIPIT_JobNodeWin = MPI_WIN_NULL;
+static MPI_Comm FLIPIT_JobNodeComm = MPI_COMM_NULL;
+static FLIPIT_JobNode* FLIPIT_JobNodeState = NULL;
+static int64_t FLIPIT_JobBudget = 0;
+
+/* the executions of the sites of this rank to inject into, ascending (--jobProfile) */
+static uint64_t* FLIPIT_JobInstances = NULL;
+static uint32_t FLIPIT_NumJobInstances = 0;
+static uint32_t FLIPIT_JobNext = 0;
+static uint64_t FLIPIT_JobExecuted = 0;
+
+static void flipit_jobInit(uint32_t argc, char** argv);
+static int flipit_jobClaim(uint64_t site);
+static double flipit_jobCountdown();
+static uint32_t flipit_jobDraw(char* profile, int rank, int size, uint32_t faults);
+static void flipit_jobFinalize();
+static int flipit_compareU64(const void* a, const void* b);
+
+static uint64_t flipit_mpiFaultSite(uint32_t site, void* callsite);
+static void flipit_mpiCaller(uint64_t site, void* callsite);
+static uint64_t flipit_payloadBytes(MPI_Datatype type, int count);
+static const void* flipit_corruptSend(const void* buf, int count, MPI_Datatype type,
+                                      uint32_t site, void* callsite, void** copy);
+static void flipit_corruptRecv(void* buf, int count, MPI_Datatype type, uint32_t site,
+                               void* callsite);
+
+/***********************************************************************************************/
+/* Wrapped MPI functions                                                                       */
+/***********************************************************************************************/
+
+/* FLIPIT_Init is called after MPI_Init and calls back into the job set up */
+int MPI_Init(int* argc, char*** argv) {
+    flipit_setInitHook(flipit_jobInit);
+    return PMPI_Init(argc, argv);
+}
+
+int MPI_Init_thread(int* argc, char*** argv, int required, int* provided) {
+    flipit_setInitHook(flipit_jobInit);
+    return PMPI_Init_thread(argc, argv, required, provided);
+}
+
+int MPI_Finalize() {
+    flipit_jobFinalize();
+    return PMPI_Finalize();
+}
+
+int MPI_Send(const void* buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+    void* copy;
+    const void* sbuf = flipit_corruptSend(buf, count, type, FLIPIT_MPI_SEND,
+                                          __builtin_return_address(0), &copy);
+    int ret = PMPI_Send(sbuf, count, type, dest, tag, comm);
+    free(copy);
+    return ret;
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+             MPI_Status* status) {
+    MPI_Status tmp;
+    if (status == MPI_STATUS_IGNORE)
+        status = &tmp;
+    int ret = PMPI_Recv(buf, count, type, source, tag, comm, status);
+    if (ret == MPI_SUCCESS) {
+        PMPI_Get_count(status, type, &count);
+        flipit_corruptRecv(buf, count, type, FLIPIT_MPI_RECV, __builtin_return_address(0));
+    }
+    return ret;
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, int dest,
+                 int sendtag, void* recvbuf, int recvcount, MPI_Datatype recvtype, int source,
+                 int recvtag, MPI_Comm comm, MPI_Status* status) {
+    MPI_Status tmp;
+    void* copy;
+    void* callsite = __builtin_return_address(0);
+    const void* sbuf = flipit_corruptSend(sendbuf, sendcount, sendtype,
+                                          FLIPIT_MPI_SENDRECV_SEND, callsite, &copy);
+    if (status == MPI_STATUS_IGNORE)
+        status = &tmp;
+    int ret = PMPI_Sendrecv(sbuf, sendcount, sendtype, dest, sendtag, recvbuf, recvcount,
+                            recvtype, source, recvtag, comm, status);
+    free(copy);
+    if (ret == MPI_SUCCESS) {
+        PMPI_Get_count(status, recvtype, &recvcount);
+        flipit_corruptRecv(recvbuf, recvcount, recvtype, FLIPIT_MPI_SENDRECV_RECV, callsite);
+    }
+    return ret;
+}
+
+int MPI_Bcast(void* buf, int count, MPI_Datatype type, int root, MPI_Comm comm) {
+    int rank, ret;
+    void* copy = NULL;
+    void* callsite = __builtin_return_address(0);
+    PMPI_Comm_rank(comm, &rank);
+
+    /* the root keeps its correct copy and broadcasts the corrupted one */
+    if (rank == root) {
+        const void* sbuf = flipit_corruptSend(buf, count, type, FLIPIT_MPI_BCAST_ROOT,
+                                              callsite, &copy);
+        if (copy == NULL)
+            return PMPI_Bcast(buf, count, type, root, comm);
+        ret = PMPI_Bcast((void*) sbuf, count, type, root, comm);
+        free(copy);
+        return ret;
+    }
+
+    ret = PMPI_Bcast(buf, count, type, root, comm);
+    if (ret == MPI_SUCCESS)
+        flipit_corruptRecv(buf, count, type, FLIPIT_MPI_BCAST_RECV, callsite);
+    return ret;
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type, MPI_Op op,
+               int root, MPI_Comm comm) {
+    int rank, ret;
+    void* copy;
+    void* callsite = __builtin_return_address(0);
+    PMPI_Comm_rank(comm, &rank);
+
+    /* corrupt this rank's contribution; in place contributions live in recvbuf */
+    const void* sbuf = sendbuf == MPI_IN_PLACE ? recvbuf : sendbuf;
+    sbuf = flipit_corruptSend(sbuf, count, type, FLIPIT_MPI_REDUCE_SEND, callsite, &copy);
+    if (copy == NULL)
+        sbuf = sendbuf;
+    ret = PMPI_Reduce(sbuf, recvbuf, count, type, op, root, comm);
+    free(copy);
+
+    if (ret == MPI_SUCCESS && rank == root)
+        flipit_corruptRecv(recvbuf, count, type, FLIPIT_MPI_REDUCE_ROOT, callsite);
+    return ret;
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type, MPI_Op op,
+                  MPI_Comm comm) {
+    int ret;
+    void* copy;
+    void* callsite = __builtin_return_address(0);
+
+    const void* sbuf = sendbuf == MPI_IN_PLACE ? recvbuf : sendbuf;
+    sbuf = flipit_corruptSend(sbuf, count, type, FLIPIT_MPI_ALLREDUCE_SEND, callsite, &copy);
+    if (copy == NULL)
+        sbuf = sendbuf;
+    ret = PMPI_Allreduce(sbuf, recvbuf, count, type, op, comm);
+    free(copy);
+
+    if (ret == MPI_SUCCESS)
+        flipit_corruptRecv(recvbuf, count, type, FLIPIT_MPI_ALLREDUCE_RECV, callsite);
+    return ret;
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by the interception layer                     */
+/***********************************************************************************************/
+
+/* FNV-1a over the base name of the calling object, the call's offset in it, and the wrapper
+   and direction: the same call gets the same site on every rank and in every run of a build,
+   wherever the object is loaded. The last FLIPIT_MPI_SITE_CACHE callers are remembered so
+   dladdr only runs the first time a call is made */
+#define FLIPIT_MPI_SITE_CACHE 64
+
+static __thread struct {
+    void* callsite;
+    uint32_t site;
+    uint64_t index;
+} FLIPIT_MPISiteCache[FLIPIT_MPI_SITE_CACHE];
+
+static uint32_t flipit_fnv1a(uint32_t h, const void* data, size_t bytes) {
+    const uint8_t* p = (const uint8_t*) data;
+    size_t i;
+    for (i = 0; i < bytes; i++)
+        h = (h ^ p[i]) * 16777619U;
+    return h;
+}
+
+static uint64_t flipit_mpiFaultSite(uint32_t site, void* callsite) {
+    uint32_t slot = (uint32_t) (((uintptr_t) callsite >> 2) + site) % FLIPIT_MPI_SITE_CACHE;
+    uint32_t h = 2166136261U;
+    uint64_t offset = (uint64_t) (uintptr_t) callsite;
+    const char* name;
+    Dl_info info;
+
+    if (FLIPIT_MPISiteCache[slot].callsite == callsite && FLIPIT_MPISiteCache[slot].site == site)
+        return FLIPIT_MPISiteCache[slot].index;
+    if (dladdr(callsite, &info) && info.dli_fname != NULL) {
+        name = strrchr(info.dli_fname, '/');
+        name = name != NULL ? name + 1 : info.dli_fname;
+        h = flipit_fnv1a(h, name, strlen(name));
+        offset = (uint64_t) ((char*) callsite - (char*) info.dli_fbase);
+    }
+    h = flipit_fnv1a(h, &offset, sizeof(offset));
+    h = flipit_fnv1a(h, &site, sizeof(site));
+
+    FLIPIT_MPISiteCache[slot].callsite = callsite;
+    FLIPIT_MPISiteCache[slot].site = site;
+    FLIPIT_MPISiteCache[slot].index = (uint64_t) FLIPIT_MPI_SITE_MODULE << 32 | h;
+    return FLIPIT_MPISiteCache[slot].index;
+}
+
+/* after an injection, names the object file and offset of the MPI call so it can be resolved
+   with addr2line */
+static void flipit_mpiCaller(uint64_t site, void* callsite) {
+    Dl_info info;
+    if (dladdr(callsite, &info) && info.dli_fname != NULL)
+        flipit_logEvent("mpi_caller", "site=%llu caller=%s+%#lx",
+                        (unsigned long long) site, info.dli_fname,
+                        (unsigned long) ((char*) callsite - (char*) info.dli_fbase));
+    else
+        flipit_logEvent("mpi_caller", "site=%llu caller=%p", (unsigned long long) site,
+                        callsite);
+}
+
+/* only dense datatypes are corrupted so a flipped bit never lands in a gap of the user's
+   memory that MPI does not touch */
+static uint64_t flipit_payloadBytes(MPI_Datatype type, int count) {
+    int size;
+    MPI_Aint lb, extent, true_lb, true_extent;
+    PMPI_Type_size(type, &size);
+    PMPI_Type_get_extent(type, &lb, &extent);
+    PMPI_Type_get_true_extent(type, &true_lb, &true_extent);
+    if (count <= 0 || true_lb != 0 || true_extent != size || extent != size)
+        return 0;
+    return (uint64_t) size * count;
+}
+
+/* the datatype is only looked at when the injector is on; otherwise the execution of the site
+   is only counted */
+static const void* flipit_corruptSend(const void* buf, int count, MPI_Datatype type,
+                                      uint32_t site, void* callsite, void** copy) {
+    double prob;
+    uint64_t nbytes = 0;
+    uint64_t index;
+    int64_t bPos;
+    void* corrupted;
+    *copy = NULL;
+
+    if (0 == (FLIPIT_GetPayloadInjection(&prob) & FLIPIT_PAYLOAD_SEND) || buf == MPI_IN_PLACE)
+        return buf;
+    if (flipit_injectorOn())
+        nbytes = flipit_payloadBytes(type, count);
+    index = flipit_mpiFaultSite(site, callsite);
+    bPos = corruptPayloadBit(index, prob, nbytes, FLIPIT_MPISiteLabel[site]);
+    if (bPos < 0)
+        return buf;
+
+    /* never modify the user's send buffer; send a corrupted copy instead, or the message as
+       it is if there is no memory for one */
+    corrupted = malloc(nbytes);
+    if (corrupted == NULL) {
+        flipit_logEvent("mpi_caller", "site=%llu copy=failed", (unsigned long long) index);
+        return buf;
+    }
+    flipit_mpiCaller(index, callsite);
+    *copy = corrupted;
+    memcpy(*copy, buf, nbytes);
+    ((uint8_t*) *copy)[bPos / 8] ^= (uint8_t) (0x1 << (bPos % 8));
+    return *copy;
+}
+
+static void flipit_corruptRecv(void* buf, int count, MPI_Datatype type, uint32_t site,
+                               void* callsite) {
+    double prob;
+    uint64_t nbytes = 0;
+    uint64_t index;
+    int64_t bPos;
+
+    if (0 == (FLIPIT_GetPayloadInjection(&prob) & FLIPIT_PAYLOAD_RECV))
+        return;
+    if (flipit_injectorOn())
+        nbytes = flipit_payloadBytes(type, count);
+    index = flipit_mpiFaultSite(site, callsite);
+    bPos = corruptPayloadBit(index, prob, nbytes, FLIPIT_MPISiteLabel[site]);
+    if (bPos < 0)
+        return;
+    flipit_mpiCaller(index, callsite);
+    ((uint8_t*) buf)[bPos / 8] ^= (uint8_t) (0x1 << (bPos % 8));
+}
+
+/***********************************************************************************************/
+/* Job-wide fault budget and fault placement                                                  */
+/***********************************************************************************************/
+
+/* collective over MPI_COMM_WORLD, called at the end of FLIPIT_Init on every rank */
+static void flipit_jobInit(uint32_t argc, char** argv) {
+    uint32_t i;
+    int rank, size, nodeRank, initialized;
+    int64_t faults = -1;
+    char* profile = NULL;
+    int64_t* counter;
+    MPI_Comm world = MPI_COMM_WORLD;
+
+    for (i = 1; argv != NULL && i + 1 < argc; i++) {
+        if (strcmp("--jobFaults", argv[i]) == 0 || strcmp("-jF", argv[i]) == 0)
+            faults = strtoll(argv[++i], NULL, 0);
+        else if (strcmp("--jobProfile", argv[i]) == 0 || strcmp("-jP", argv[i]) == 0)
+            profile = argv[++i];
+    }
+    if (faults < 0 && profile == NULL)
+        return;
+    PMPI_Initialized(&initialized);
+    if (!initialized || FLIPIT_JobWin != MPI_WIN_NULL) {
+        printf("Warning: FlipIt job-wide faults need FLIPIT_Init once, after MPI_Init\n");
+        return;
+    }
+    if (faults < 0)
+        faults = 1;
+    PMPI_Comm_rank(world, &rank);
+    PMPI_Comm_size(world, &size);
+
+    if (profile != NULL)
+        faults = flipit_jobDraw(profile, rank, size, faults);
+    FLIPIT_JobBudget = faults;
+    /* the local budget never runs out before the job's does */
+    FLIPIT_SetMaxInjections(FLIPIT_NumJobInstances > 0 ? FLIPIT_NumJobInstances : faults);
+
+    /* the budget lives on rank 0 and is only ever changed with MPI_Fetch_and_op */
+    PMPI_Win_allocate(rank == 0 ? sizeof(int64_t) : 0, sizeof(int64_t), MPI_INFO_NULL, world,
+                      &counter, &FLIPIT_JobWin);
+    PMPI_Win_lock_all(MPI_MODE_NOCHECK, FLIPIT_JobWin);
+    if (rank == 0) {
+        *counter = faults;
+        PMPI_Win_sync(FLIPIT_JobWin);
+    }
+
+    PMPI_Comm_split_type(world, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &FLIPIT_JobNodeComm);
+    PMPI_Comm_rank(FLIPIT_JobNodeComm, &nodeRank);
+    PMPI_Win_allocate_shared(nodeRank == 0 ? sizeof(FLIPIT_JobNode) : 0, 1, MPI_INFO_NULL,
+                             FLIPIT_JobNodeComm, &FLIPIT_JobNodeState, &FLIPIT_JobNodeWin);
+    if (nodeRank == 0)
+        memset(FLIPIT_JobNodeState, 0, sizeof(FLIPIT_JobNode));
+    else {
+        MPI_Aint bytes;
+        int disp;
+        PMPI_Win_shared_query(FLIPIT_JobNodeWin, 0, &bytes, &disp, &FLIPIT_JobNodeState);
+    }
+    PMPI_Barrier(world);
+
+    flipit_setFaultClaim(flipit_jobClaim);
+    if (rank == 0)
+        printf("FlipIt job: at most %lld faults in %d ranks\n", (long long) faults, size);
+}
+
+/* slow path only: a rank that is about to inject takes one fault from the job's budget */
+static int flipit_jobClaim(uint64_t site) {
+    FLIPIT_JobNode* node = FLIPIT_JobNodeState;
+    int64_t take = -1;
+    int64_t left = 0;
+
+    if (__atomic_load_n(&node->exhausted, __ATOMIC_ACQUIRE) == 0) {
+        /* the ranks and threads of a node take turns, so once one of them finds the budget
+           used up none of the others asks rank 0 again */
+        while (__atomic_exchange_n(&node->lock, 1, __ATOMIC_ACQUIRE))
+            ;
+        if (node->exhausted == 0) {
+            PMPI_Fetch_and_op(&take, &left, MPI_INT64_T, 0, 0, MPI_SUM, FLIPIT_JobWin);
+            PMPI_Win_flush(0, FLIPIT_JobWin);
+            if (left > 0)
+                node->injected++;
+            if (left <= 1)
+                __atomic_store_n(&node->exhausted, 1, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&node->lock, 0, __ATOMIC_RELEASE);
+    }
+    if (left <= 1)
+        FLIPIT_SetRankInject(FLIPIT_OFF);
+    /* faults left in the job's budget after this claim */
+    flipit_logEvent("job_claim", "site=%llu granted=%d left=%lld", (unsigned long long) site,
+                    left > 0, (long long) (left > 0 ? left - 1 : 0));
+    return left > 0;
+}
+
+/* the fault probability of a rank with planned executions: zero at each of them */
+static double flipit_jobCountdown() {
+    if (++FLIPIT_JobExecuted != FLIPIT_JobInstances[FLIPIT_JobNext])
+        return 1.;
+    if (FLIPIT_JobNext + 1 < FLIPIT_NumJobInstances)
+        FLIPIT_JobNext++;
+    return 0.;
+}
+
+/* draws the faults uniformly from the site executions of every rank's histogram (the
+   FLIPIT_Finalize output of libcorrupt_histo, counting every site as FLIPIT_CountdownTimer
+   does) and hands each rank its executions. Returns the number of faults */
+static uint32_t flipit_jobDraw(char* profile, int rank, int size, uint32_t faults) {
+    char name[500];
+    char line[256];
+    unsigned long long count;
+    uint64_t executions = 0;
+    uint64_t* all = NULL;
+    uint64_t* draws = NULL;
+    int* counts = NULL;
+    int* displs = NULL;
+    int mine = 0;
+    uint32_t i, n = 0;
+    int r;
+    FILE* infile;
+
+    snprintf(name, sizeof(name), "%s_%d", profile, rank);
+    infile = fopen(name, "r");
+    if (infile == NULL)
+        printf("Warning: FlipIt job profile %s not found; rank %d gets no faults\n", name, rank);
+    else {
+        while (fgets(line, sizeof(line), infile) != NULL)
+            if (sscanf(line, "Location %*s %llu", &count) == 1)
+                executions += count;
+        fclose(infile);
+    }
+
+    if (rank == 0) {
+        all = (uint64_t*) malloc(size*sizeof(uint64_t));
+        counts = (int*) calloc(size, sizeof(int));
+        displs = (int*) calloc(size, sizeof(int));
+        draws = (uint64_t*) malloc((faults + 1)*sizeof(uint64_t));
+    }
+    PMPI_Gather(&executions, 1, MPI_UINT64_T, all, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        uint64_t total = 0, base = 0;
+        uint32_t j = 0;
+        for (r = 0; r < size; r++)
+            total += all[r];
+        for (i = 0; i < faults && total > 0; i++) {
+            uint64_t x = (uint64_t) (drand48()*total);
+            draws[n++] = x < total ? x : total - 1;
+        }
+        /* split the executions of the job into the ranks' own, counted from 1 */
+        qsort(draws, n, sizeof(uint64_t), flipit_compareU64);
+        for (i = 0, r = 0; r < size; r++) {
+            displs[r] = i;
+            for ( ; j < n && draws[j] < base + all[r]; j++) {
+                /* the same execution drawn twice is one fault */
+                if (i > (uint32_t) displs[r] && draws[i - 1] == draws[j] - base + 1)
+                    continue;
+                draws[i++] = draws[j] - base + 1;
+            }
+            counts[r] = i - displs[r];
+            base += all[r];
+        }
+        n = i;
+        printf("FlipIt job: %u faults drawn from %llu site executions (%s_*)\n", n,
+               (unsigned long long) total, profile);
+    }
+    PMPI_Bcast(&n, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+    PMPI_Scatter(counts, 1, MPI_INT, &mine, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    FLIPIT_JobInstances = (uint64_t*) malloc((mine > 0 ? mine : 1)*sizeof(uint64_t));
+    PMPI_Scatterv(draws, counts, displs, MPI_UINT64_T, FLIPIT_JobInstances, mine,
+                  MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    FLIPIT_NumJobInstances = mine;
+
+    if (mine > 0) {
+        FLIPIT_SetRankInject(FLIPIT_ON);
+        FLIPIT_SetFaultProbability(flipit_jobCountdown);
+        printf("FlipIt job: rank %d injects at site execution %llu%s\n", rank,
+               (unsigned long long) FLIPIT_JobInstances[0], mine > 1 ? " and later" : "");
+    }
+    else
+        FLIPIT_SetRankInject(FLIPIT_OFF);
+
+    free(all);
+    free(draws);
+    free(counts);
+    free(displs);
+    return n;
+}
+
+static void flipit_jobFinalize() {
+    int rank;
+    int64_t left = 0, none = 0;
+    if (FLIPIT_JobWin == MPI_WIN_NULL)
+        return;
+    flipit_setFaultClaim(NULL);
+
+    PMPI_Barrier(MPI_COMM_WORLD);
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        PMPI_Fetch_and_op(&none, &left, MPI_INT64_T, 0, 0, MPI_NO_OP, FLIPIT_JobWin);
+        PMPI_Win_flush(0, FLIPIT_JobWin);
+        printf("FlipIt job: %lld of %lld faults injected\n",
+               (long long) (FLIPIT_JobBudget - (left > 0 ? left : 0)),
+               (long long) FLIPIT_JobBudget);
+    }
+    PMPI_Win_unlock_all(FLIPIT_JobWin);
+    PMPI_Win_free(&FLIPIT_JobWin);
+    PMPI_Win_free(&FLIPIT_JobNodeWin);
+    PMPI_Comm_free(&FLIPIT_JobNodeComm);
+    FLIPIT_JobNodeState = NULL;
+    free(FLIPIT_JobInstances);
+    FLIPIT_JobInstances = NULL;
+    FLIPIT_NumJobInstances = 0;
+}
+
+static int flipit_compareU64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return x < y ? -1 : x > y;
+}
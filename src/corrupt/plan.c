@@ -0,0 +1,154 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: plan.c                                                                                */
+/*                                                                                             */
+/* Description: Exact injections from a campaign plan file (--plan). The file holds one        */
+/*              FLIPIT_PlanEntry per planned fault, sorted by trial, and is mapped read only.  */
+/*              The entries of this trial and rank are copied into a small table, each with a  */
+/*              counter of the executions of its site (or of every site). A fault fires when   */
+/*              its counter reaches the planned instance, so no random numbers are drawn and   */
+/*              the same plan always injects the same faults.                                  */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "runtime.h"
+
+#define FLIPIT_MAX_PLANNED 64
+
+typedef struct {
+    uint64_t site;
+    uint64_t instance;
+    uint64_t count;
+    uint32_t bit;
+    uint32_t fired;
+} FLIPIT_Planned;
+
+/* faults of this trial that have not fired yet; zero keeps the hot path on the usual checks */
+uint32_t FLIPIT_PlanLeft = 0;
+
+static const FLIPIT_PlanEntry* FLIPIT_PlanEntries = NULL;
+static uint64_t FLIPIT_PlanCount = 0;
+static size_t FLIPIT_PlanBytes = 0;
+static FLIPIT_Planned FLIPIT_PlanTable[FLIPIT_MAX_PLANNED];
+static uint32_t FLIPIT_NumPlanned = 0;
+
+static uint64_t flipit_planFirst(uint64_t trial);
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* called for every execution of a site while faults are left. Returns the bit to flip within
+   nbits or FLIPIT_PLAN_MISS */
+uint32_t flipit_planHit(uint64_t site, uint32_t nbits) {
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumPlanned; i++) {
+        FLIPIT_Planned* p = &FLIPIT_PlanTable[i];
+        if (p->fired || (p->site != FLIPIT_PLAN_ANY_SITE && p->site != site))
+            continue;
+        if (++p->count == p->instance) {
+            p->fired = 1;
+            FLIPIT_PlanLeft--;
+            return nbits > 0 ? p->bit % nbits : 0;
+        }
+    }
+    return FLIPIT_PLAN_MISS;
+}
+
+int flipit_planOpen(char* name) {
+    struct stat st;
+    const FLIPIT_PlanHeader* header;
+    void* map;
+    int fd = open(name, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(FLIPIT_PlanHeader)) {
+        printf("Warning: FlipIt could not read the plan file %s\n", name);
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("FlipIt: mmap of the plan file failed");
+        return 0;
+    }
+
+    header = (const FLIPIT_PlanHeader*) map;
+    if (header->magic != FLIPIT_PLAN_MAGIC || sizeof(FLIPIT_PlanHeader)
+        + header->count * sizeof(FLIPIT_PlanEntry) > (uint64_t) st.st_size) {
+        printf("Warning: %s is not a FlipIt plan file\n", name);
+        munmap(map, st.st_size);
+        return 0;
+    }
+    FLIPIT_PlanEntries = (const FLIPIT_PlanEntry*) (header + 1);
+    FLIPIT_PlanCount = header->count;
+    FLIPIT_PlanBytes = st.st_size;
+    return 1;
+}
+
+/* copies the faults planned for this trial on this rank into the table */
+void flipit_planSelect(uint64_t trial, uint32_t rank) {
+    uint64_t i;
+
+    FLIPIT_NumPlanned = 0;
+    FLIPIT_PlanLeft = 0;
+    if (FLIPIT_PlanEntries == NULL)
+        return;
+
+    for (i = flipit_planFirst(trial); i < FLIPIT_PlanCount; i++) {
+        const FLIPIT_PlanEntry* e = &FLIPIT_PlanEntries[i];
+        if (e->trial != trial)
+            break;
+        if (e->rank != rank || (e->thread != 0 && e->thread != FLIPIT_PLAN_ANY_THREAD))
+            continue;
+        if (FLIPIT_NumPlanned == FLIPIT_MAX_PLANNED) {
+            printf("Warning: FlipIt only injects the first %d planned faults of a trial\n",
+                   FLIPIT_MAX_PLANNED);
+            break;
+        }
+        FLIPIT_PlanTable[FLIPIT_NumPlanned].site = e->site;
+        FLIPIT_PlanTable[FLIPIT_NumPlanned].instance = e->instance;
+        FLIPIT_PlanTable[FLIPIT_NumPlanned].count = 0;
+        FLIPIT_PlanTable[FLIPIT_NumPlanned].bit = e->bit;
+        FLIPIT_PlanTable[FLIPIT_NumPlanned].fired = 0;
+        FLIPIT_NumPlanned++;
+    }
+    FLIPIT_PlanLeft = FLIPIT_NumPlanned;
+    flipit_logEvent("planned", "trial=%llu faults=%u", (unsigned long long) trial,
+                    FLIPIT_NumPlanned);
+}
+
+int flipit_planActive() {
+    return FLIPIT_PlanEntries != NULL;
+}
+
+void flipit_planClose() {
+    if (FLIPIT_PlanEntries != NULL)
+        munmap((void*) ((const FLIPIT_PlanHeader*) FLIPIT_PlanEntries - 1), FLIPIT_PlanBytes);
+    FLIPIT_PlanEntries = NULL;
+    FLIPIT_PlanCount = 0;
+    FLIPIT_NumPlanned = 0;
+    FLIPIT_PlanLeft = 0;
+}
+
+/* first entry of the trial (binary search; entries are sorted by trial) */
+static uint64_t flipit_planFirst(uint64_t trial) {
+    uint64_t lo = 0, hi = FLIPIT_PlanCount;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (FLIPIT_PlanEntries[mid].trial < trial)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
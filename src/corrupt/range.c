@@ -0,0 +1,138 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: range.c                                                                               */
+/*                                                                                             */
+/* Description: Address ranges for code compiled with -rangeCheck, whose loads and stores only */
+/*              call into the runtime when the address is in a registered range. The check    */
+/*              inlined at every site compares the address against the two intervals in       */
+/*              FLIPIT_RangeInline. With up to two (merged) ranges they are the ranges and the */
+/*              check is exact; with more, the first one is their hull and the corrupt         */
+/*              functions look the address the site left in FLIPIT_RangeAddr up in the sorted */
+/*              table of ranges before they inject.                                            */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "runtime.h"
+
+#define FLIPIT_MAX_RANGES 1024
+
+typedef struct {
+    const void* buf;
+    uint64_t nbytes;
+} FLIPIT_Range;
+
+/* base and length of the two intervals checked inline; a length of zero matches nothing */
+uint64_t FLIPIT_RangeInline[4] = {0, 0, 0, 0};
+__thread uint64_t FLIPIT_RangeAddr = 0;
+int FLIPIT_RangeSearch = 0;
+
+static FLIPIT_Range FLIPIT_Ranges[FLIPIT_MAX_RANGES];
+static uint32_t FLIPIT_NumRanges = 0;
+
+/* the registered ranges sorted and merged into disjoint intervals */
+static uint64_t FLIPIT_RangeBase[FLIPIT_MAX_RANGES];
+static uint64_t FLIPIT_RangeEnd[FLIPIT_MAX_RANGES];
+static uint32_t FLIPIT_NumIntervals = 0;
+
+static void flipit_rangeBuild();
+static int flipit_rangeCompare(const void* a, const void* b);
+
+/***********************************************************************************************/
+/* The functions below are the functions that should be called by a user of FlipIt             */
+/***********************************************************************************************/
+
+/* registering a range again updates its size. Returns the number of registered ranges or -1 if
+   there is no room left. Ranges should change while no instrumented code runs on other
+   threads */
+int FLIPIT_RegisterRange(const void* buf, uint64_t nbytes) {
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumRanges; i++)
+        if (FLIPIT_Ranges[i].buf == buf) {
+            FLIPIT_Ranges[i].nbytes = nbytes;
+            flipit_rangeBuild();
+            return FLIPIT_NumRanges;
+        }
+    if (FLIPIT_NumRanges == FLIPIT_MAX_RANGES) {
+        printf("Warning: FlipIt can only target %d address ranges; ignoring %p\n",
+               FLIPIT_MAX_RANGES, buf);
+        return -1;
+    }
+    FLIPIT_Ranges[FLIPIT_NumRanges].buf = buf;
+    FLIPIT_Ranges[FLIPIT_NumRanges].nbytes = nbytes;
+    FLIPIT_NumRanges++;
+    flipit_rangeBuild();
+    return FLIPIT_NumRanges;
+}
+
+void FLIPIT_UnregisterRange(const void* buf) {
+    uint32_t i;
+    for (i = 0; i < FLIPIT_NumRanges; i++)
+        if (FLIPIT_Ranges[i].buf == buf) {
+            FLIPIT_Ranges[i] = FLIPIT_Ranges[--FLIPIT_NumRanges];
+            flipit_rangeBuild();
+            return;
+        }
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* branchless binary search for the last interval starting at or below addr */
+int flipit_rangeHit(uint64_t addr) {
+    const uint64_t* base = FLIPIT_RangeBase;
+    uint32_t n = FLIPIT_NumIntervals;
+    if (n == 0)
+        return 0;
+    while (n > 1) {
+        uint32_t half = n / 2;
+        base = base[half] <= addr ? base + half : base;
+        n -= half;
+    }
+    return *base <= addr && addr < FLIPIT_RangeEnd[base - FLIPIT_RangeBase];
+}
+
+static void flipit_rangeBuild() {
+    uint32_t i, n = 0;
+    FLIPIT_Range sorted[FLIPIT_MAX_RANGES];
+
+    memcpy(sorted, FLIPIT_Ranges, FLIPIT_NumRanges*sizeof(FLIPIT_Range));
+    qsort(sorted, FLIPIT_NumRanges, sizeof(FLIPIT_Range), flipit_rangeCompare);
+    for (i = 0; i < FLIPIT_NumRanges; i++) {
+        uint64_t base = (uint64_t) sorted[i].buf;
+        uint64_t end = base + sorted[i].nbytes;
+        if (sorted[i].nbytes == 0)
+            continue;
+        if (n > 0 && base <= FLIPIT_RangeEnd[n - 1]) {
+            if (end > FLIPIT_RangeEnd[n - 1])
+                FLIPIT_RangeEnd[n - 1] = end;
+            continue;
+        }
+        FLIPIT_RangeBase[n] = base;
+        FLIPIT_RangeEnd[n++] = end;
+    }
+    FLIPIT_NumIntervals = n;
+
+    memset(FLIPIT_RangeInline, 0, sizeof(FLIPIT_RangeInline));
+    FLIPIT_RangeSearch = n > 2;
+    if (n > 2) {
+        FLIPIT_RangeInline[0] = FLIPIT_RangeBase[0];
+        FLIPIT_RangeInline[1] = FLIPIT_RangeEnd[n - 1] - FLIPIT_RangeBase[0];
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        FLIPIT_RangeInline[2*i] = FLIPIT_RangeBase[i];
+        FLIPIT_RangeInline[2*i + 1] = FLIPIT_RangeEnd[i] - FLIPIT_RangeBase[i];
+    }
+}
+
+static int flipit_rangeCompare(const void* a, const void* b) {
+    uint64_t x = (uint64_t) ((const FLIPIT_Range*) a)->buf;
+    uint64_t y = (uint64_t) ((const FLIPIT_Range*) b)->buf;
+    return x < y ? -1 : x > y;
+}
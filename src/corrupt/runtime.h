@@ -0,0 +1,78 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: runtime.h                                                                             */
+/*                                                                                             */
+/* Description: Internal interface shared by the source files of the FlipIt runtime. Nothing  */
+/*              in here is meant to be called by the user.                                     */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#ifndef FLIPIT_RUNTIME_H
+#define FLIPIT_RUNTIME_H
+
+#include "corrupt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* house keeping (corrupt.c) */
+uint32_t flipit_getRank();
+void flipit_logEvent(char* event, char* fmt, ...);
+void flipit_trialCompare(const FLIPIT_CompareResult* res);
+void flipit_trialReset(uint64_t seed);
+void flipit_logTrial(char* outcome, int signal);
+void flipit_finalizeTrial(char* outcome);
+void flipit_setInitHook(void (*hook)(uint32_t argc, char** argv));
+void flipit_setFaultClaim(int (*claim)(uint64_t site));
+int flipit_injectorOn();
+
+/* corruption propagation tracking (taint.c) */
+void flipit_taintInjected(uint64_t fault_index);
+void flipit_taintFinalize();
+
+/* persistent trial loop (trial.c) */
+int flipit_trialMasked();
+
+/* exact injections from a plan file (plan.c) */
+#define FLIPIT_PLAN_MISS UINT32_MAX
+extern uint32_t FLIPIT_PlanLeft;
+uint32_t flipit_planHit(uint64_t site, uint32_t nbits);
+int flipit_planOpen(char* name);
+void flipit_planSelect(uint64_t trial, uint32_t rank);
+int flipit_planActive();
+void flipit_planClose();
+
+/* live telemetry page (telemetry.c) */
+extern int FLIPIT_TelemetryOn;
+extern __thread uint64_t FLIPIT_TelemetrySites;
+extern __thread uint64_t FLIPIT_TelemetryAttempts;
+void flipit_telemetryInit(char* name, uint32_t rank, uint64_t numSites);
+void flipit_telemetryFlush();
+void flipit_telemetryInjected(uint64_t site);
+void flipit_telemetryFinalize();
+
+/* address ranges targeted by -rangeCheck builds (range.c) */
+int flipit_rangeHit(uint64_t addr);
+
+/* binary crash record (crash.c) */
+void flipit_crashInit(char* name, uint32_t rank);
+void flipit_crashInjected(uint64_t site);
+void flipit_crashFinalize();
+
+/* golden run state hashes (checkpoint.c) */
+void flipit_checkpointInit(char* golden, char* record);
+void flipit_checkpointReset();
+void flipit_checkpointFinalize();
+int flipit_checkpointMasked();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,255 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: taint.c                                                                               */
+/*                                                                                             */
+/* Description: Runtime for corruption propagation tracking (compile with -taint). The pass   */
+/*              clones every instrumented function into a tracking version that carries a     */
+/*              shadow bit for each value and calls the functions below for memory. Nothing   */
+/*              here runs until an injection fires and switches execution to the clones.     */
+/*              Memory is shadowed with one bit per byte in 512 byte pages that are only      */
+/*              allocated once something in the corresponding 4KB page is tainted.            */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include "runtime.h"
+
+#define FLIPIT_SHADOW_PAGE_BITS 12
+#define FLIPIT_SHADOW_LEVEL_BITS 12
+#define FLIPIT_SHADOW_LEVEL_SIZE (1 << FLIPIT_SHADOW_LEVEL_BITS)
+#define FLIPIT_SHADOW_PAGE_SIZE (1 << (FLIPIT_SHADOW_PAGE_BITS - 3))
+#define FLIPIT_TAINT_MAX_ARGS 8
+
+/* read by the code inserted by the compiler pass */
+int32_t FLIPIT_TaintActive = 0;
+uint8_t FLIPIT_TaintArgs[FLIPIT_TAINT_MAX_ARGS];
+uint8_t FLIPIT_TaintRet = 0;
+
+static uint32_t FLIPIT_TaintMode = FLIPIT_OFF;
+
+/* 48-bit address -> [12 bits][12 bits][12 bits] -> bitmap of a 4KB page */
+static void*** FLIPIT_Shadow[FLIPIT_SHADOW_LEVEL_SIZE];
+
+/* statistics reported through the event log */
+static uint64_t FLIPIT_TaintedBytes = 0;
+static uint64_t FLIPIT_TaintedPeak = 0;
+static uint64_t FLIPIT_TaintedMilestone = 1;
+static uint64_t FLIPIT_ShadowPages = 0;
+static uint64_t FLIPIT_TaintedSites = 0;
+static uint64_t FLIPIT_TaintStart = 0;
+static uint64_t FLIPIT_TaintUntracked = 0;
+static uint8_t* FLIPIT_TaintedSiteMap = NULL;
+static uint32_t FLIPIT_TaintedSiteMapSize = 0;
+
+static uint8_t* flipit_shadowPage(uintptr_t addr, int create);
+static void flipit_shadowUpdate(uintptr_t addr, uint64_t size, uint8_t taint);
+
+/***********************************************************************************************/
+/* The functions below are the functions that should be called by a user of FlipIt             */
+/***********************************************************************************************/
+
+void FLIPIT_SetTaintTracking(int state) {
+    if (state == FLIPIT_ON || state == FLIPIT_OFF)
+        FLIPIT_TaintMode = state;
+}
+
+uint64_t FLIPIT_GetTaintedBytes() {
+    return FLIPIT_TaintedBytes;
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* an injection fired; switch to the tracking clones and seed the corrupted site */
+void flipit_taintInjected(uint64_t fault_index) {
+    if (FLIPIT_TaintMode == FLIPIT_OFF)
+        return;
+    if (FLIPIT_TaintActive == 0)
+        FLIPIT_TaintStart = FLIPIT_GetExecutedInstructionCount();
+    FLIPIT_TaintActive = 1;
+    flipit_logEvent("taint_start", "site=%llu", (unsigned long long) fault_index);
+}
+
+void flipit_taintFinalize() {
+    uint32_t i;
+    if (FLIPIT_TaintActive == 0)
+        return;
+    flipit_logEvent("taint_summary", "bytes=%llu peak_bytes=%llu sites=%llu shadow_pages=%llu "
+                    "since_injection=%llu untracked=%llu propagation=%s",
+                    (unsigned long long) FLIPIT_TaintedBytes,
+                    (unsigned long long) FLIPIT_TaintedPeak,
+                    (unsigned long long) FLIPIT_TaintedSites,
+                    (unsigned long long) FLIPIT_ShadowPages,
+                    (unsigned long long) (FLIPIT_GetExecutedInstructionCount() - FLIPIT_TaintStart),
+                    (unsigned long long) FLIPIT_TaintUntracked,
+                    FLIPIT_TaintUntracked == 0 ? "tracked" : "unknown");
+
+    for (i = 0; i < FLIPIT_SHADOW_LEVEL_SIZE; i++) {
+        if (FLIPIT_Shadow[i] != NULL) {
+            uint32_t j, k;
+            for (j = 0; j < FLIPIT_SHADOW_LEVEL_SIZE; j++) {
+                if (FLIPIT_Shadow[i][j] == NULL)
+                    continue;
+                for (k = 0; k < FLIPIT_SHADOW_LEVEL_SIZE; k++)
+                    free(FLIPIT_Shadow[i][j][k]);
+                free(FLIPIT_Shadow[i][j]);
+            }
+            free(FLIPIT_Shadow[i]);
+            FLIPIT_Shadow[i] = NULL;
+        }
+    }
+    free(FLIPIT_TaintedSiteMap);
+    FLIPIT_TaintedSiteMap = NULL;
+    FLIPIT_TaintedSiteMapSize = 0;
+    FLIPIT_TaintActive = 0;
+
+    /* the persistent trial loop tracks every trial from scratch */
+    FLIPIT_TaintedBytes = FLIPIT_TaintedPeak = 0;
+    FLIPIT_TaintedMilestone = 1;
+    FLIPIT_ShadowPages = FLIPIT_TaintedSites = FLIPIT_TaintUntracked = 0;
+}
+
+static uint8_t* flipit_shadowPage(uintptr_t addr, int create) {
+    uint32_t l1 = (addr >> (FLIPIT_SHADOW_PAGE_BITS + 2*FLIPIT_SHADOW_LEVEL_BITS))
+                  & (FLIPIT_SHADOW_LEVEL_SIZE - 1);
+    uint32_t l2 = (addr >> (FLIPIT_SHADOW_PAGE_BITS + FLIPIT_SHADOW_LEVEL_BITS))
+                  & (FLIPIT_SHADOW_LEVEL_SIZE - 1);
+    uint32_t l3 = (addr >> FLIPIT_SHADOW_PAGE_BITS) & (FLIPIT_SHADOW_LEVEL_SIZE - 1);
+
+    if (FLIPIT_Shadow[l1] == NULL) {
+        if (!create) return NULL;
+        FLIPIT_Shadow[l1] = (void***) calloc(FLIPIT_SHADOW_LEVEL_SIZE, sizeof(void**));
+    }
+    if (FLIPIT_Shadow[l1][l2] == NULL) {
+        if (!create) return NULL;
+        FLIPIT_Shadow[l1][l2] = (void**) calloc(FLIPIT_SHADOW_LEVEL_SIZE, sizeof(void*));
+    }
+    if (FLIPIT_Shadow[l1][l2][l3] == NULL) {
+        if (!create) return NULL;
+        FLIPIT_Shadow[l1][l2][l3] = calloc(FLIPIT_SHADOW_PAGE_SIZE, sizeof(uint8_t));
+        FLIPIT_ShadowPages++;
+    }
+    return (uint8_t*) FLIPIT_Shadow[l1][l2][l3];
+}
+
+static void flipit_shadowUpdate(uintptr_t addr, uint64_t size, uint8_t taint) {
+    uint8_t* page = NULL;
+    uintptr_t pageAddr = UINTPTR_MAX;
+    uint64_t i;
+
+    for (i = 0; i < size; i++, addr++) {
+        uint32_t offset = addr & ((1 << FLIPIT_SHADOW_PAGE_BITS) - 1);
+        uint8_t mask = 0x1 << (offset & 0x7);
+        if (pageAddr != (addr >> FLIPIT_SHADOW_PAGE_BITS)) {
+            pageAddr = addr >> FLIPIT_SHADOW_PAGE_BITS;
+            page = flipit_shadowPage(addr, taint);
+        }
+        if (page == NULL)
+            continue;
+
+        if (taint && !(page[offset >> 3] & mask)) {
+            page[offset >> 3] |= mask;
+            FLIPIT_TaintedBytes++;
+        }
+        else if (!taint && (page[offset >> 3] & mask)) {
+            page[offset >> 3] &= ~mask;
+            FLIPIT_TaintedBytes--;
+        }
+    }
+
+    if (FLIPIT_TaintedBytes > FLIPIT_TaintedPeak)
+        FLIPIT_TaintedPeak = FLIPIT_TaintedBytes;
+    if (FLIPIT_TaintedBytes >= FLIPIT_TaintedMilestone) {
+        flipit_logEvent("taint_bytes", "bytes=%llu", (unsigned long long) FLIPIT_TaintedBytes);
+        while (FLIPIT_TaintedMilestone <= FLIPIT_TaintedBytes)
+            FLIPIT_TaintedMilestone *= 2;
+    }
+}
+
+/***********************************************************************************************/
+/* The functions below this are inserted by the compiler pass into the tracking clones         */
+/***********************************************************************************************/
+
+uint8_t flipit_taintLoad(void* addr, uint64_t size) {
+    uintptr_t a = (uintptr_t) addr;
+    uint8_t* page = NULL;
+    uintptr_t pageAddr = UINTPTR_MAX;
+    uint64_t i;
+
+    for (i = 0; i < size; i++, a++) {
+        uint32_t offset = a & ((1 << FLIPIT_SHADOW_PAGE_BITS) - 1);
+        if (pageAddr != (a >> FLIPIT_SHADOW_PAGE_BITS)) {
+            pageAddr = a >> FLIPIT_SHADOW_PAGE_BITS;
+            page = flipit_shadowPage(a, 0);
+        }
+        if (page != NULL && (page[offset >> 3] & (0x1 << (offset & 0x7))))
+            return 1;
+    }
+    return 0;
+}
+
+void flipit_taintStore(void* addr, uint64_t size, uint8_t taint) {
+    flipit_shadowUpdate((uintptr_t) addr, size, taint);
+}
+
+/* like memmove, an overlapping destination above the source is copied from the end */
+void flipit_taintCopy(void* dst, void* src, uint64_t size) {
+    uint64_t i;
+    if ((uintptr_t) dst > (uintptr_t) src)
+        for (i = size; i > 0; i--)
+            flipit_shadowUpdate((uintptr_t) dst + i - 1, 1,
+                                flipit_taintLoad((char*) src + i - 1, 1));
+    else
+        for (i = 0; i < size; i++)
+            flipit_shadowUpdate((uintptr_t) dst + i, 1, flipit_taintLoad((char*) src + i, 1));
+}
+
+/* the corrupted value of an injection in untracked code reached memory */
+void flipit_taintSeedStore(void* addr, uint64_t size) {
+    if (FLIPIT_TaintActive == 0)
+        return;
+    flipit_logEvent("taint_seed", "address=%p bytes=%llu", addr, (unsigned long long) size);
+    flipit_shadowUpdate((uintptr_t) addr, size, 1);
+}
+
+/* the corrupted value of an injection in untracked code was also used in registers, where it
+   is not followed until the next call into a clone, so the summary can undercount */
+void flipit_taintUntracked(uint64_t site) {
+    if (FLIPIT_TaintActive == 0)
+        return;
+    FLIPIT_TaintUntracked++;
+    flipit_logEvent("taint_untracked", "site=%llu propagation=unknown", (unsigned long long) site);
+}
+
+/* record that an instrumented site computed a value derived from corrupted data. The map is
+   indexed by the offset of the site in its module, so sites of different modules (-siteModule)
+   with the same offset are only reported once */
+void flipit_taintSite(uint64_t site, uint8_t taint) {
+    uint32_t offset = (uint32_t) site;
+    if (!taint)
+        return;
+
+    if (offset >= (uint64_t) FLIPIT_TaintedSiteMapSize * 8) {
+        uint64_t size = FLIPIT_TaintedSiteMapSize == 0 ? 1024 : FLIPIT_TaintedSiteMapSize;
+        while (offset >= size * 8)
+            size *= 2;
+        FLIPIT_TaintedSiteMap = (uint8_t*) realloc(FLIPIT_TaintedSiteMap, size);
+        memset(FLIPIT_TaintedSiteMap + FLIPIT_TaintedSiteMapSize, 0,
+               size - FLIPIT_TaintedSiteMapSize);
+        FLIPIT_TaintedSiteMapSize = size;
+    }
+    if (FLIPIT_TaintedSiteMap[offset / 8] & (0x1 << (offset % 8)))
+        return;
+
+    FLIPIT_TaintedSiteMap[offset / 8] |= 0x1 << (offset % 8);
+    FLIPIT_TaintedSites++;
+    flipit_logEvent("taint_site", "site=%llu sites=%llu since_injection=%llu",
+                    (unsigned long long) site,
+                    (unsigned long long) FLIPIT_TaintedSites,
+                    (unsigned long long) (FLIPIT_GetExecutedInstructionCount() - FLIPIT_TaintStart));
+}
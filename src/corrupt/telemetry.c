@@ -0,0 +1,133 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: telemetry.c                                                                           */
+/*                                                                                             */
+/* Description: Live counters of a running process (--telemetry <name>) in the POSIX shared   */
+/*              memory object /<name>_<rank>, read by scripts/flipit-top. The page holds a     */
+/*              FLIPIT_Telemetry header and one cache line per thread. Every thread counts in */
+/*              thread local variables and only copies them to its own line every             */
+/*              FLIPIT_TELEMETRY_BATCH site executions and when it injects, so the hot path   */
+/*              never writes to memory another core reads.                                    */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "runtime.h"
+
+int FLIPIT_TelemetryOn = 0;
+__thread uint64_t FLIPIT_TelemetrySites = 0;
+__thread uint64_t FLIPIT_TelemetryAttempts = 0;
+
+static __thread uint64_t FLIPIT_TelemetryInjections = 0;
+static __thread uint64_t FLIPIT_TelemetryLastSite = UINT64_MAX;
+static __thread FLIPIT_TelemetryThread* FLIPIT_TelemetrySlot = NULL;
+
+static FLIPIT_Telemetry* FLIPIT_TelemetryPage = NULL;
+static char FLIPIT_TelemetryObject[256];
+
+static uint64_t flipit_now();
+static FLIPIT_TelemetryThread* flipit_telemetrySlot();
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+void flipit_telemetryInit(char* name, uint32_t rank, uint64_t numSites) {
+    int fd;
+    void* map;
+
+    if (name == NULL)
+        return;
+    snprintf(FLIPIT_TelemetryObject, sizeof(FLIPIT_TelemetryObject), "/%s_%u",
+             name[0] == '/' ? name + 1 : name, rank);
+    fd = shm_open(FLIPIT_TelemetryObject, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(FLIPIT_Telemetry)) != 0) {
+        printf("Warning: FlipIt could not create the telemetry page %s\n",
+               FLIPIT_TelemetryObject);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    map = mmap(NULL, sizeof(FLIPIT_Telemetry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("FlipIt: mmap of the telemetry page failed");
+        shm_unlink(FLIPIT_TelemetryObject);
+        return;
+    }
+
+    /* ftruncate zeroed the page; the magic goes last so a reader never sees half a header */
+    FLIPIT_TelemetryPage = (FLIPIT_Telemetry*) map;
+    FLIPIT_TelemetryPage->version = FLIPIT_TELEMETRY_VERSION;
+    FLIPIT_TelemetryPage->size = sizeof(FLIPIT_Telemetry);
+    FLIPIT_TelemetryPage->pid = getpid();
+    FLIPIT_TelemetryPage->rank = rank;
+    FLIPIT_TelemetryPage->slots = FLIPIT_TELEMETRY_SLOTS;
+    FLIPIT_TelemetryPage->start = flipit_now();
+    FLIPIT_TelemetryPage->state = FLIPIT_TELEMETRY_RUNNING;
+    FLIPIT_TelemetryPage->numSites = numSites;
+    __atomic_store_n(&FLIPIT_TelemetryPage->magic, FLIPIT_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+    FLIPIT_TelemetryOn = 1;
+    flipit_telemetryFlush();
+}
+
+/* copies the counters of the calling thread to its line of the page */
+void flipit_telemetryFlush() {
+    FLIPIT_TelemetryThread* t = FLIPIT_TelemetrySlot;
+    if (FLIPIT_TelemetryPage == NULL)
+        return;
+    if (t == NULL && (t = flipit_telemetrySlot()) == NULL)
+        return;
+    __atomic_store_n(&t->sites, FLIPIT_TelemetrySites, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->attempts, FLIPIT_TelemetryAttempts, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->injections, FLIPIT_TelemetryInjections, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->lastSite, FLIPIT_TelemetryLastSite, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->heartbeat, flipit_now(), __ATOMIC_RELEASE);
+}
+
+void flipit_telemetryInjected(uint64_t site) {
+    if (!FLIPIT_TelemetryOn)
+        return;
+    FLIPIT_TelemetryInjections++;
+    FLIPIT_TelemetryLastSite = site;
+    flipit_telemetryFlush();
+}
+
+/* the page stays readable until the process exits but is no longer found by name */
+void flipit_telemetryFinalize() {
+    if (FLIPIT_TelemetryPage == NULL)
+        return;
+    flipit_telemetryFlush();
+    __atomic_store_n(&FLIPIT_TelemetryPage->state, FLIPIT_TELEMETRY_FINISHED, __ATOMIC_RELEASE);
+    shm_unlink(FLIPIT_TelemetryObject);
+    munmap(FLIPIT_TelemetryPage, sizeof(FLIPIT_Telemetry));
+    FLIPIT_TelemetryPage = NULL;
+    FLIPIT_TelemetryOn = 0;
+}
+
+static uint64_t flipit_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* threads beyond FLIPIT_TELEMETRY_SLOTS share the last line, which then shows whichever of
+   them flushed last */
+static FLIPIT_TelemetryThread* flipit_telemetrySlot() {
+    uint32_t i = __atomic_fetch_add(&FLIPIT_TelemetryPage->active, 1, __ATOMIC_RELAXED);
+    if (i >= FLIPIT_TELEMETRY_SLOTS) {
+        i = FLIPIT_TELEMETRY_SLOTS - 1;
+        __atomic_store_n(&FLIPIT_TelemetryPage->active, FLIPIT_TELEMETRY_SLOTS,
+                         __ATOMIC_RELAXED);
+    }
+    FLIPIT_TelemetrySlot = &FLIPIT_TelemetryPage->thread[i];
+    FLIPIT_TelemetrySlot->tid = (uint64_t) syscall(SYS_gettid);
+    return FLIPIT_TelemetrySlot;
+}
@@ -0,0 +1,193 @@
+/***********************************************************************************************/
+/* This file is licensed under the University of Illinois/NCSA Open Source License.            */
+/* See LICENSE.TXT for details.                                                                */
+/***********************************************************************************************/
+
+/***********************************************************************************************/
+/*                                                                                             */
+/* Name: trial.c                                                                               */
+/*                                                                                             */
+/* Description: Persistent trial loop. Runs many injection trials inside one process instead  */
+/*              of launching a process per trial. Each trial starts from fresh injection       */
+/*              counts, budget, countdown, and random number state and ends with one trial     */
+/*              record. A crash inside a trial is caught with a signal handler that jumps back */
+/*              to FLIPIT_RunTrial. When the kernel may leave the process in a bad state       */
+/*              (corrupted heap, stack overflow) each trial can instead run in a forked child. */
+/*              A trial a checkpoint finds masked (checkpoint.c) ends early the same way.      */
+/*                                                                                             */
+/***********************************************************************************************/
+
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "runtime.h"
+
+#define FLIPIT_TRIAL_STACK_SIZE (64*1024)
+
+static const int FLIPIT_TrialSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define FLIPIT_NUM_TRIAL_SIGNALS (sizeof(FLIPIT_TrialSignals) / sizeof(int))
+
+static int FLIPIT_TrialIsolation = FLIPIT_TRIAL_INPROCESS;
+static int FLIPIT_TrialRunning = 0;
+static int FLIPIT_TrialHandlers = 0;
+static int FLIPIT_TrialMasked = 0;
+static sigjmp_buf FLIPIT_TrialJmp;
+static volatile sig_atomic_t FLIPIT_TrialArmed = 0;
+static volatile sig_atomic_t FLIPIT_TrialSignal = 0;
+static struct sigaction FLIPIT_TrialOldActions[FLIPIT_NUM_TRIAL_SIGNALS];
+
+static void flipit_trialInstallHandlers();
+static void flipit_trialHandler(int sig);
+static int flipit_runTrialInProcess(uint64_t seed, void (*trial)(void*), void* arg);
+static int flipit_runTrialBody(void (*trial)(void*), void* arg);
+static int flipit_runTrialForked(uint64_t seed, void (*trial)(void*), void* arg);
+
+/***********************************************************************************************/
+/* The functions below are the functions that should be called by a user of FlipIt             */
+/***********************************************************************************************/
+
+void FLIPIT_TrialBegin(uint64_t seed) {
+    if (FLIPIT_TrialRunning)
+        FLIPIT_TrialEnd();
+    flipit_trialReset(seed);
+    FLIPIT_TrialRunning = 1;
+    FLIPIT_TrialMasked = 0;
+}
+
+int FLIPIT_TrialEnd() {
+    if (!FLIPIT_TrialRunning)
+        return FLIPIT_TRIAL_COMPLETED;
+    flipit_taintFinalize();
+    flipit_logTrial(FLIPIT_TrialMasked ? "masked" : "completed", 0);
+    FLIPIT_TrialRunning = 0;
+    return FLIPIT_TrialMasked ? FLIPIT_TRIAL_MASKED : FLIPIT_TRIAL_COMPLETED;
+}
+
+void FLIPIT_SetTrialIsolation(int mode) {
+    if (mode == FLIPIT_TRIAL_INPROCESS || mode == FLIPIT_TRIAL_FORK)
+        FLIPIT_TrialIsolation = mode;
+}
+
+int FLIPIT_RunTrial(uint64_t seed, void (*trial)(void*), void* arg) {
+    if (FLIPIT_TrialIsolation == FLIPIT_TRIAL_FORK)
+        return flipit_runTrialForked(seed, trial, arg);
+    return flipit_runTrialInProcess(seed, trial, arg);
+}
+
+/***********************************************************************************************/
+/* The functions below this are used internally by FlipIt                                      */
+/***********************************************************************************************/
+
+/* installed once on the first trial. A signal outside of a trial is handed back to whatever
+   handler was there before */
+static void flipit_trialInstallHandlers() {
+    struct sigaction action;
+    stack_t stack;
+    uint32_t i;
+
+    if (FLIPIT_TrialHandlers)
+        return;
+
+    /* run the handler on its own stack so a stack overflow in the kernel is caught too */
+    stack.ss_sp = malloc(FLIPIT_TRIAL_STACK_SIZE);
+    stack.ss_size = FLIPIT_TRIAL_STACK_SIZE;
+    stack.ss_flags = 0;
+    if (stack.ss_sp != NULL)
+        sigaltstack(&stack, NULL);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flipit_trialHandler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (i = 0; i < FLIPIT_NUM_TRIAL_SIGNALS; i++)
+        sigaction(FLIPIT_TrialSignals[i], &action, &FLIPIT_TrialOldActions[i]);
+    FLIPIT_TrialHandlers = 1;
+}
+
+static void flipit_trialHandler(int sig) {
+    uint32_t i;
+    if (FLIPIT_TrialArmed) {
+        FLIPIT_TrialArmed = 0;
+        FLIPIT_TrialSignal = sig;
+        siglongjmp(FLIPIT_TrialJmp, 1);
+    }
+
+    for (i = 0; i < FLIPIT_NUM_TRIAL_SIGNALS; i++)
+        if (FLIPIT_TrialSignals[i] == sig)
+            sigaction(sig, &FLIPIT_TrialOldActions[i], NULL);
+    raise(sig);
+}
+
+/* a checkpoint found the state back on the golden run after the injection. Inside
+   FLIPIT_RunTrial the trial ends right here; between FLIPIT_TrialBegin and FLIPIT_TrialEnd it
+   is recorded as masked when it ends. Returns 0 outside of a trial */
+int flipit_trialMasked() {
+    if (!FLIPIT_TrialRunning)
+        return 0;
+    FLIPIT_TrialMasked = 1;
+    if (FLIPIT_TrialArmed) {
+        FLIPIT_TrialArmed = 0;
+        siglongjmp(FLIPIT_TrialJmp, 2);
+    }
+    return 1;
+}
+
+static int flipit_runTrialInProcess(uint64_t seed, void (*trial)(void*), void* arg) {
+    FLIPIT_TrialBegin(seed);
+    return flipit_runTrialBody(trial, arg);
+}
+
+static int flipit_runTrialBody(void (*trial)(void*), void* arg) {
+    int jump;
+
+    flipit_trialInstallHandlers();
+
+    /* savemask so the crashing signal is unblocked again after the jump */
+    jump = sigsetjmp(FLIPIT_TrialJmp, 1);
+    if (jump == 0) {
+        FLIPIT_TrialArmed = 1;
+        trial(arg);
+        FLIPIT_TrialArmed = 0;
+        return FLIPIT_TrialEnd();
+    }
+    if (jump == 2)
+        return FLIPIT_TrialEnd();
+
+    flipit_taintFinalize();
+    flipit_logTrial("crashed", FLIPIT_TrialSignal);
+    FLIPIT_TrialRunning = 0;
+    return FLIPIT_TRIAL_CRASHED;
+}
+
+/* the child runs the trial with the same crash handling and reports it. The parent only
+   writes the record if the child could not (it died before its handler ran), in which case
+   the counts of the child are lost and the record shows those of the parent */
+static int flipit_runTrialForked(uint64_t seed, void (*trial)(void*), void* arg) {
+    pid_t pid;
+    int status;
+
+    FLIPIT_TrialBegin(seed);
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0) {
+        perror("FlipIt: fork failed, running trial in process");
+        return flipit_runTrialBody(trial, arg);
+    }
+    if (pid == 0) {
+        status = flipit_runTrialBody(trial, arg);
+        fflush(NULL);
+        _exit(status);
+    }
+
+    FLIPIT_TrialRunning = 0;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return FLIPIT_TRIAL_CRASHED;
+    if (WIFEXITED(status) && (WEXITSTATUS(status) == FLIPIT_TRIAL_COMPLETED
+                              || WEXITSTATUS(status) == FLIPIT_TRIAL_MASKED))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        flipit_logTrial("crashed", WTERMSIG(status));
+    return FLIPIT_TRIAL_CRASHED;
+}
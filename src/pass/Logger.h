@@ -2,8 +2,11 @@
 #define LOGGER_H
 
 #include <fstream>
+#include <stdint.h>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <map>
 
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/DebugInfo.h>
@@ -33,14 +36,14 @@ typedef enum {
 class LogFile
 {
   public:
-    LogFile(std::string srcName, unsigned long currentSite, std::string suffix = ".LLVM.bin", int bufSize = 8192, char version = 1) {
+    LogFile(std::string srcName, uint64_t currentSite, std::string suffix = ".LLVM.bin", int bufSize = 8192, char version = 3) {
         init(srcName, currentSite, suffix, bufSize, version);
     }
     //LogFile(char* filename, string::string suffix = ".LLVM.txt", int bufSize = 8192, char version) {
     //    init(filename, bufSize, versions);
     //}
 
-    void init(std::string srcName, unsigned long currentSite, std::string suffix, int bufSize, char version) {
+    void init(std::string srcName, uint64_t currentSite, std::string suffix, int bufSize, char version) {
         srcFile = srcName;
         outfile.open(srcName+suffix, std::ios::out | std::ios::binary);
         buffer = new char[bufSize];
@@ -55,7 +58,7 @@ class LogFile
         delete [] buffer;
     }
 
-    void logFunctionHeader(unsigned long site, std::string name)
+    void logFunctionHeader(uint64_t site, std::string name)
     {
         //errs() << "\n\n" << name << "\n";
         // make sure we have enough room
@@ -71,7 +74,7 @@ class LogFile
         memcpy(buffer+currSize, name.c_str(), std::min((int)name.size(), (1 << 8) -1));
         currSize += std::min((int)name.size(), (1 << 8) -1);
 
-        // current fault site index
+        // current fault site index (64 bits: module number and offset in the module)
         oldSite = site - 1;
         char* ptr = (char*) &site;
         for (unsigned i=0; i < sizeof(site); i++) {
@@ -79,7 +82,7 @@ class LogFile
         }
 
     }
-    void logInst(unsigned long site, int injType, int comment, Instruction* I)
+    void logInst(uint64_t site, int injType, int comment, Instruction* I)
     {
         // make sure we have enough room
         if (currSize + 5 > bufSize) // 5 bytes compressed data
@@ -99,6 +102,48 @@ class LogFile
         // location in file
         logFileLocation(I);
     } 
+    /* version 2: after the sites of a function, one (site - class representative,
+       class size) pair per site in site order */
+    void logClasses(const std::vector<std::pair<uint32_t, uint32_t> >& classes)
+    {
+        if (currSize + 1 + sizeof(uint32_t) > bufSize)
+            write();
+
+        // DUMMY operand flag
+        buffer[currSize++] = 254;
+        uint32_t count = classes.size();
+        memcpy(buffer+currSize, &count, sizeof(count));
+        currSize += sizeof(count);
+
+        for (unsigned i = 0; i < classes.size(); i++) {
+            if (currSize + 2*sizeof(uint32_t) > bufSize)
+                write();
+            memcpy(buffer+currSize, &classes[i].first, sizeof(uint32_t));
+            currSize += sizeof(uint32_t);
+            memcpy(buffer+currSize, &classes[i].second, sizeof(uint32_t));
+            currSize += sizeof(uint32_t);
+        }
+    }
+    /* version 3: after the sites of a function, the static estimate of how often every site
+       executes per invocation of the function, in site order */
+    void logWeights(const std::vector<float>& weights)
+    {
+        if (currSize + 1 + sizeof(uint32_t) > bufSize)
+            write();
+
+        // DUMMY operand flag
+        buffer[currSize++] = 253;
+        uint32_t count = weights.size();
+        memcpy(buffer+currSize, &count, sizeof(count));
+        currSize += sizeof(count);
+
+        for (unsigned i = 0; i < weights.size(); i++) {
+            if (currSize + sizeof(float) > bufSize)
+                write();
+            memcpy(buffer+currSize, &weights[i], sizeof(float));
+            currSize += sizeof(float);
+        }
+    }
     inline bool needsWriting() { return currSize > 0; }
     void write() {
         if (needsWriting()) {
@@ -115,42 +160,27 @@ class LogFile
         }
     }
 
-  private:
-    void logFileHeader(char version)
-    {
-        // file version
-        buffer[currSize++] = version;
-        
-        //source file properties
-        oldFile = srcFile;
-        unsigned short size = srcFile.size();
-        char* ptr = (char*)&(size);
-        buffer[currSize++] = *ptr;
-        buffer[currSize++] = *(ptr+1);
-        memcpy(buffer+currSize, srcFile.c_str(), std::min((int)size, (1 << 16) -1));
-        currSize += std::min((int)size, (1 << 16) -1);
-    }
-
-    unsigned char getType(int injType)
+    static unsigned char getType(int injType)
     {
         if (injType < ARITHMETIC_FP && injType > CONTROL_BRANCH)
             injType = UNKNOWN_INJ;
         return (unsigned char)injType;
     }
     
-    unsigned char getInfo(int comment)
+    static unsigned char getInfo(int comment)
     {
         if (comment < ARITHMETIC_FP && comment > UNKNOWN_INJ_TYPE)
             comment = UNKNOWN_INJ_TYPE;
         return (unsigned char)comment;
     }
-    void logFileLocation(Instruction* I)
+
+    /* source file of an instruction, "__NF" without debugging information */
+    static std::string getLocation(Instruction* I, unsigned short& lineNum)
     {
-        unsigned short size = 0;
-        unsigned short lineNum = 0;
-        std::string location = "";
+        std::string location = "__NF";
         MDNode* N = I->getMetadata("dbg");
-        
+        lineNum = 0;
+
         if (N != NULL) {
 #if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 6
             DILocation Loc(N);
@@ -161,13 +191,39 @@ class LogFile
             location = Loc->getDirectory().str()  + "/" + Loc->getFilename().str();
             lineNum = Loc->getLine();
 #endif
+        }
+        return location;
+    }
+
+  private:
+    void logFileHeader(char version)
+    {
+        // file version
+        buffer[currSize++] = version;
+        
+        //source file properties
+        oldFile = srcFile;
+        unsigned short size = srcFile.size();
+        char* ptr = (char*)&(size);
+        buffer[currSize++] = *ptr;
+        buffer[currSize++] = *(ptr+1);
+        memcpy(buffer+currSize, srcFile.c_str(), std::min((int)size, (1 << 16) -1));
+        currSize += std::min((int)size, (1 << 16) -1);
+    }
+
+    void logFileLocation(Instruction* I)
+    {
+        unsigned short size = 0;
+        unsigned short lineNum = 0;
+        std::string location = getLocation(I, lineNum);
+        
+        if (location != "__NF") {
             if (oldFile != location) {
                 size = location.size();
                 size |= NEW_FILE_MASK;//0x80; // set MSB
             }
         }
         else /* no debugging information */ {
-            location = "__NF";
             if (oldFile != "__NF") {
                 size = 4 | NEW_FILE_MASK;//0x80;
             }
@@ -203,10 +259,100 @@ class LogFile
     ofstream outfile;
     std::string srcFile;
     std::string oldFile;
-    unsigned long oldSite;
+    uint64_t oldSite;
     char* buffer;
     unsigned  bufSize;
     unsigned currSize;
 };
-#endif
 
+/* the sites of a module as the pass puts them into the flipit_sites section of its object
+   file: a header, one entry per site in site order, then the strings the entries refer to
+   (string 0 is the source file of the module). The layout is FLIPIT_SiteTable and
+   FLIPIT_SiteEntry in corrupt.h; the linker concatenates the tables of all modules */
+#define SITE_TABLE_MAGIC   0x5345544953544946ULL    /* "FITSITES" */
+#define SITE_TABLE_VERSION 1
+
+class SiteTable
+{
+  public:
+    struct Entry {
+        uint32_t line;
+        uint16_t file;
+        uint16_t function;
+        uint8_t  opcode;
+        uint8_t  typeInfo;
+        uint16_t reserved;
+        uint32_t classOffset;   // site - class representative
+        float    weight;
+    };
+
+    SiteTable(std::string srcName, uint64_t firstSite) : firstSite(firstSite), function(0) {
+        getString(srcName);
+    }
+
+    void logFunctionHeader(std::string name) { function = getString(name); }
+
+    void logInst(uint64_t site, int injType, int comment, Instruction* I, float weight)
+    {
+        assert(firstSite + entries.size() == site && "Sites differ > 1.\n");
+        Entry e;
+        unsigned short lineNum;
+        e.file = getString(LogFile::getLocation(I, lineNum));
+        e.line = lineNum;
+        e.function = function;
+        e.opcode = (uint8_t) I->getOpcode();
+        e.typeInfo = (LogFile::getType(injType) << INFO_SIZE) | LogFile::getInfo(comment);
+        e.reserved = 0;
+        e.classOffset = 0;
+        e.weight = weight;
+        entries.push_back(e);
+    }
+
+    void logClass(uint64_t site, uint32_t offset) { entries[site - firstSite].classOffset = offset; }
+
+    inline bool empty() { return entries.empty(); }
+
+    /* the table padded to a multiple of 8 bytes, so the tables of all modules follow each
+       other without gaps in the section */
+    std::string bytes()
+    {
+        std::string table(32, '\0');
+        uint64_t magic = SITE_TABLE_MAGIC;
+        uint32_t header[4] = {SITE_TABLE_VERSION, 0, (uint32_t) entries.size(),
+                              (uint32_t) strings.size()};
+
+        if (!entries.empty())
+            table.append((const char*) &entries[0], entries.size()*sizeof(Entry));
+        for (unsigned i = 0; i < strings.size(); i++)
+            table.append(strings[i].c_str(), strings[i].size() + 1);
+        table.append((8 - table.size() % 8) % 8, '\0');
+
+        header[1] = table.size();
+        memcpy(&table[0], &magic, sizeof(magic));
+        memcpy(&table[8], header, 2*sizeof(uint32_t));
+        memcpy(&table[16], &firstSite, sizeof(firstSite));
+        memcpy(&table[24], &header[2], 2*sizeof(uint32_t));
+        return table;
+    }
+
+  private:
+    /* file and function names are stored once; any past the 65535th share the last one */
+    uint16_t getString(const std::string& s)
+    {
+        std::map<std::string, uint16_t>::iterator it = stringIdx.find(s);
+        if (it != stringIdx.end())
+            return it->second;
+        if (strings.size() >= 0xFFFF)
+            return 0xFFFE;
+        stringIdx[s] = strings.size();
+        strings.push_back(s);
+        return strings.size() - 1;
+    }
+
+    uint64_t firstSite;
+    uint16_t function;
+    std::vector<Entry> entries;
+    std::vector<std::string> strings;
+    std::map<std::string, uint16_t> stringIdx;
+};
+#endif
@@ -36,6 +36,11 @@ FlipIt::DynamicFaults::DynamicFaults(Module* M) {
     ptr_err = true;
     srcFile = "UNKNOWN"; 
     stateFile = "FlipItState"; 
+    taint = false;
+    inlineMask = false;
+    armedGuard = false;
+    rangeCheck = false;
+    census = false;
     
     //Module::FunctionListType &functionList = M->getFunctionList();
     init();
@@ -54,6 +59,7 @@ FlipIt::DynamicFaults::DynamicFaults(Module* M) {
     func_corruptIntAdr_64bit = NULL;
     func_corruptFloatAdr_32bit = NULL;
     func_corruptFloatAdr_64bit = NULL;
+    siteTable = NULL;
     
 
 }
@@ -81,6 +87,13 @@ FlipIt::DynamicFaults::DynamicFaults(string _funcList, string _configPath, doubl
     ptr_err = _ptr_err;
     srcFile = _srcFile;
     stateFile = _stateFile;
+#ifndef COMPILE_PASS
+    taint = false;
+    inlineMask = false;
+    armedGuard = false;
+    rangeCheck = false;
+    census = false;
+#endif
 
     func_corruptIntData_8bit = NULL;
     func_corruptIntData_16bit = NULL;
@@ -95,6 +108,7 @@ FlipIt::DynamicFaults::DynamicFaults(string _funcList, string _configPath, doubl
     func_corruptIntAdr_64bit = NULL;
     func_corruptFloatAdr_32bit = NULL;
     func_corruptFloatAdr_64bit = NULL;
+    siteTable = NULL;
     
 #ifndef COMPILE_PASS
    // Module::FunctionListType &functionList = M->getFunctionList();
@@ -134,16 +148,35 @@ bool FlipIt::DynamicFaults::runOnModule(Module &Mod) {
             continue;
 
         logfile->logFunctionHeader(faultIdx, cstr);
+        if (siteTable)
+            siteTable->logFunctionHeader(cstr);
+        instrumented.push_back(&*F);
+        buildSiteClasses(&*F);
+        buildSiteWeights(&*F);
+        uint64_t firstSite = faultIdx;
+        memset(censusTypes, 0, sizeof(censusTypes));
         inst_iterator I, E, Inext;
         I = inst_begin(F);
         E = inst_end(F);
+        if (inlineMask && !census)
+            armInline(&*F, &*I);
         for ( ; I != E;) {
             Inext = I;
             Inext++;
             Value *in = &(*I);
             if (in == NULL)
                 continue;
-            if ( (isa<StoreInst>(in) || isa<LoadInst>(in)
+            if (rangeCheck && !inlineMask) {
+                /* only the values loaded from or stored to memory are sites */
+                if (LoadInst* LI = dyn_cast<LoadInst>(in)) {
+                    rangeAddr = LI->getPointerOperand();
+                    injectFault(LI);
+                } else if (StoreInst* SI = dyn_cast<StoreInst>(in)) {
+                    rangeAddr = SI->getPointerOperand();
+                    injectFault(SI);
+                }
+            }
+            else if ( (isa<StoreInst>(in) || isa<LoadInst>(in)
                 || isa<BinaryOperator>(in) || isa<CmpInst>(in)
                 || isa<CallInst>(in) || isa<AllocaInst>(in) 
                 || isa<GetElementPtrInst>(in)
@@ -153,14 +186,14 @@ bool FlipIt::DynamicFaults::runOnModule(Module &Mod) {
             }
             
             // gather all phis to place at top of BB (TODO: can we do this inplace?)
-            if (isa<PHINode>(&(*I))){
+            if (isa<PHINode>(&(*I)) && !census){
                 auto BB = I->getParent();
                 I->removeFromParent();
                 I->insertBefore(BB->getFirstInsertionPt());
             }
 
             // ensure any landing pad inst directly follows all PHINodes
-            if (isa<LandingPadInst>(&(*I))){
+            if (isa<LandingPadInst>(&(*I)) && !census){
                 auto BB = I->getParent();
                 I->removeFromParent();
                 I->insertBefore(BB->getFirstInsertionPt());
@@ -168,8 +201,30 @@ bool FlipIt::DynamicFaults::runOnModule(Module &Mod) {
             /* find next inst that is original to the function */
             while (I != Inext && I != E) { I++; }
         }
+        if (inlineMask && !census)
+            finishInline(faultIdx - inlineFirstSite);
+        if (rangeCheck && !inlineMask && !census)
+            guardRanges(&*F);
+        if (armedGuard && !census)
+            guardArmed(&*F);
+        logSiteWeights();
+        unsigned numClasses = logSiteClasses();
+        if (census)
+            censusFunction(cstr, faultIdx - firstSite, numClasses);
     }/*end for*/
 
+    if (census)
+        errs() << "FlipIt census: " << faultIdx - oldFaultIdx << " fault sites in "
+               << srcFile << " (" << srcFile << ".census.csv)\n";
+    else if (taint && inlineMask)
+        errs() << "Warning: -taint has no corrupt calls to follow with -inlineMask; ignoring it\n";
+    else if (taint)
+        cloneForTaint();
+    if (rangeCheck && inlineMask)
+        errs() << "Warning: -rangeCheck needs a call at every site, not -inlineMask; ignoring it\n";
+    if (siteTable && !siteTable->empty())
+        emitSiteTable();
+
     return finalize();
 }
 
@@ -240,28 +295,56 @@ void  FlipIt::DynamicFaults::init() {
     assert(arith_err == 1 || arith_err == 0);
     assert(ptr_err == 1 || ptr_err == 0);
 	
-    unsigned int t_byte_val = (byte_val << 28) & 0xF0000000;
-    unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-    unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-    parameter = t_byte_val | t_bit_val | t_faultIdx;
-    
+
+    /* the specialized runtime entry point for how the byte and bit are chosen */
+    if (byte_val != -1 && bit_val != -1)
+        corruptSuffix = "_fixed";
+    else if (byte_val != -1)
+        corruptSuffix = "_fixedByte";
+    else if (bit_val != -1)
+        corruptSuffix = "_fixedBit";
+    else
+        corruptSuffix = "_random";
 
     readConfig(configPath);
     splitAtSpace();
-    /*Cache function references of the function defined in Corrupt.c to all inserting of
-     *call instructions to them */
-    unsigned long sum = cacheFunctions();
+    /* declare the corrupt functions of the runtime (corrupt.c) that calls are inserted to */
+    i64Ty = Type::getInt64Ty(getGlobalContext());
+    if (!census)
+        declareCorruptFunctions();
+    unsigned long sum = countInstructions();
 
     // TODO: get stateFile from config
 #ifndef COMPILE_PASS
     sum = 0;
 #endif
-    faultIdx = updateStateFile(stateFile.c_str(), sum);
+    /* sites are numbered from the state file within a module, whose number is in the upper
+       32 bits of the index */
+#ifdef COMPILE_PASS
+    /* the last module is the runtime's MPI payload sites (FLIPIT_MPI_SITE_MODULE) */
+    assert(siteModule < 0xFFFFFFFFU && "-siteModule 4294967295 is reserved for MPI sites");
+    siteBase = (uint64_t) siteModule << 32;
+#else
+    siteBase = 0;
+#endif
+    /* a census numbers the sites the way the next instrumented build will */
+    faultIdx = siteBase + updateStateFile(stateFile.c_str(), sum, census);
+    oldFaultIdx = faultIdx;
     logfile = new LogFile(srcFile, faultIdx); 
+#ifdef COMPILE_PASS
+    /* an instrumented object carries its sites, so the runtime and the scripts need neither
+       the state file nor the log file */
+    siteTable = census ? NULL : new SiteTable(srcFile, faultIdx);
+#endif
+    if (census) {
+        censusFile.open(srcFile + ".census.csv");
+        censusFile << "function,first_site,sites,classes,Arith-FP,Pointer,Arith-Fix,"
+                   << "Control-Loop,Control-Branch,Unknown\n";
+    }
     
-    //set up args to be used in corrupt calls
-    args.reserve(3);
-    for (int i = 0; i < 3; i++)
+    //set up args to be used in corrupt calls (site, prob, value, pos, width)
+    args.reserve(5);
+    for (int i = 0; i < 5; i++)
         args.push_back(NULL);
     
     // create constant ints for each byte position
@@ -269,7 +352,6 @@ void  FlipIt::DynamicFaults::init() {
         byteVal[i] = ConstantInt::get(IntegerType::getInt32Ty(
             getGlobalContext()), i);
     }
-    i64Ty = Type::getInt64Ty(getGlobalContext());
 }
 
 void FlipIt::DynamicFaults::readConfig(string path) {
@@ -318,6 +400,10 @@ void FlipIt::DynamicFaults::readConfig(string path) {
 
 bool  FlipIt::DynamicFaults::finalize() {
     logfile->close();
+    delete siteTable;
+    siteTable = NULL;
+    if (censusFile.is_open())
+        censusFile.close();
 
     // put all phinode insts at top of BB
     //for (auto phi : phis) {
@@ -329,7 +415,7 @@ bool  FlipIt::DynamicFaults::finalize() {
         phi->insertBefore(BB->getFirstInsertionPt());
     }
     //delete logfile;
-    return oldFaultIdx != faultIdx;
+    return !census;
 }
 
 void FlipIt::DynamicFaults::splitAtSpace() {
@@ -363,7 +449,9 @@ Value* FlipIt::DynamicFaults::getInstProb(Instruction* I) {
     return instProbs.find(type) != instProbs.end() ? instProbs[type] : instProbs["default"];
 }
 
-unsigned long FlipIt::DynamicFaults::updateStateFile(const char* stateFile, unsigned long sum)
+/* readOnly returns the next site index without creating or updating the state file */
+unsigned long FlipIt::DynamicFaults::updateStateFile(const char* stateFile, unsigned long sum,
+                                                     bool readOnly)
 {
     unsigned long startNum = 0;
 
@@ -378,6 +466,11 @@ unsigned long FlipIt::DynamicFaults::updateStateFile(const char* stateFile, unsi
     std::fstream file(stateFilePath);
 
     // read file only if it was corectly open
+    if (!file.is_open() && readOnly) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return 0;
+    }
     if (!file.is_open()) {
         errs() << "Error opening state file: " << stateFilePath 
                 << "\nAssuming fault index of 0 and creating the file\n";
@@ -395,7 +488,8 @@ unsigned long FlipIt::DynamicFaults::updateStateFile(const char* stateFile, unsi
     // clear the file cause the eof bit is reached
     file.clear();
     file.seekg(0, ios::beg);
-    file << (startNum + sum);
+    if (!readOnly)
+        file << (startNum + sum);
     file.close();
 
     // release file lock
@@ -409,6 +503,12 @@ bool FlipIt::DynamicFaults::injectVector(Instruction* I) {
     //TODO: call rand at runtime to get value
     int e = 0;
     auto idx = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), e);
+    if (census) {
+        /* the element is looked at, never inserted; freed once the function is logged */
+        auto elm = ExtractElementInst::Create(I, idx, "elm");
+        censusScratch.push_back(elm);
+        return injectFault(elm);
+    }
     BasicBlock::iterator Inext = I; Inext++;
 
     auto elm = ExtractElementInst::Create(I, idx, "elm", Inext);
@@ -424,7 +524,6 @@ bool FlipIt::DynamicFaults::injectVector(Instruction* I) {
 bool FlipIt::DynamicFaults::injectControl_NEW(Instruction* I) {
 
     /* Build argument list before calling Corrupt function */
-    args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
     args[1] = getInstProb(I);
 
 
@@ -466,7 +565,6 @@ bool FlipIt::DynamicFaults::injectControl_NEW(Instruction* I) {
 bool FlipIt::DynamicFaults::injectArithmetic_NEW(Instruction* I)
 {
     /* Build argument list before calling Corrupt function */
-    args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
     args[1] = getInstProb(I);
 
     /* We handle these in a special way */
@@ -501,7 +599,6 @@ bool FlipIt::DynamicFaults::injectArithmetic_NEW(Instruction* I)
 bool FlipIt::DynamicFaults::injectPointer_NEW(Instruction* I)
 {
     /*Build argument list before calling Corrupt function*/
-    args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
     args[1] = getInstProb(I);
 
     if (isa<StoreInst>(I) && I->getOperand(0)->getType()->isPointerTy()) {
@@ -522,7 +619,6 @@ bool FlipIt::DynamicFaults::injectPointer_NEW(Instruction* I)
 bool FlipIt::DynamicFaults::injectCall_NEW(Instruction* I)
 {
     /*Build argument list before calling Corrupt function*/
-    args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
     args[1] = getInstProb(I);
     
     if (!isa<CallInst>(I))
@@ -550,27 +646,24 @@ bool FlipIt::DynamicFaults::injectResult(Instruction* I)
     Value* corruptVal = NULL;
     CallInst* call = NULL;
     auto type = I->getType();
-    
+    setCorruptArgs(type);
+
+    if (census)
+        return censusSite(type, RESULT);
+    if (inlineMask) {
+        if (!(type->isIntegerTy() || type->isFloatTy() || type->isDoubleTy()
+              || type->isPointerTy()) || type->getPrimitiveSizeInBits() > 64)
+            return false;
+        std::vector<User*> users(I->user_begin(), I->user_end());
+        corruptVal = inlineCorrupt(I, INext);
+        for (auto U : users)
+            U->replaceUsesOfWith(I, corruptVal);
+        comment = RESULT;
+        return true;
+    }
 
     /*Integer Data*/
     if (type->isIntegerTy()) {
-        /* encode integer size in the byte val */
-        int size = Layout->getTypeStoreSize(I->getType());
-        if (byte_val == -1) {
-            unsigned int t_byte_val = ((-size) << 28) & 0xF0000000;
-            unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-            unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-            parameter = t_byte_val | t_bit_val | t_faultIdx;
-            args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
-        }
-        else if (size < byte_val) {
-            unsigned int t_byte_val = ((byte_val % size) << 28) & 0xF0000000;
-            unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-            unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-            parameter = t_byte_val | t_bit_val | t_faultIdx;
-            args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
-        }
-        
         if (! (type->isIntegerTy(64))) {
             args[2] = new ZExtInst(I, i64Ty, "zxt", INext);
         }
@@ -606,6 +699,8 @@ bool FlipIt::DynamicFaults::injectResult(Instruction* I)
     if (corruptVal == NULL) {
         corruptVal = call;
     }
+    if (rangeCheck && call != NULL)
+        rangeCalls.push_back(std::make_pair(call, rangeAddr));
     if (corruptVal) {
         I->replaceAllUsesWith(corruptVal);
 
@@ -636,31 +731,20 @@ bool FlipIt::DynamicFaults::injectInOperand(Instruction* I, int operand)
     Value* corruptVal = NULL;
     CallInst* call = NULL;
     auto type = I->getOperand(operand)->getType();
+    setCorruptArgs(type);
+
+    if (census)
+        return censusSite(type, operand + 1);
+    if (inlineMask) {
+        if (!(type->isIntegerTy() || type->isFloatTy() || type->isDoubleTy()
+              || type->isPointerTy()) || type->getPrimitiveSizeInBits() > 64)
+            return false;
+        I->setOperand(operand, inlineCorrupt(I->getOperand(operand), I));
+        comment = operand + 1;
+        return true;
+    }
     /*Integer Data*/
     if (type->isIntegerTy()) {
-        /* Incode integer size in the byte val */
-        int size = Layout->getTypeStoreSize(I->getOperand(operand)->getType());
-        if (byte_val == -1) {
-            unsigned int t_byte_val = ((-size) << 28) & 0xF0000000;
-            unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-            unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-            parameter = t_byte_val | t_bit_val | t_faultIdx;
-            args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
-        }
-        else if (size < byte_val) {
-            //parameter &= 0x0FFFFFFFF; // zero out old byte field
-            //parameter |= ((byte_val % size) << 28); // insert new
-            
-            unsigned int t_byte_val = ((byte_val % size) << 28) & 0xF0000000;
-            unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-            unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-            //errs() << "BYTE= " << size << " BIT= " << bit_val << " IDX= " << faultIdx << "\n";
-            //errs() << "BYTE= " << (t_byte_val >> 28) << " BIT= " << ((t_bit_val >> 24) & 0xF) << " IDX= " << (faultIdx & 0x00FFFFFF) << "\n";
-            parameter = t_byte_val | t_bit_val | t_faultIdx;
-            errs() << "FIDX = " << faultIdx << "parameter Idx = " << (parameter & 0x00FFFFFF) << " \n";
-            args[0] = ConstantInt::get(IntegerType::getInt32Ty(getGlobalContext()), parameter);
-        }
-        
         if (! (type->isIntegerTy(64))) {
             args[2] = new ZExtInst(I->getOperand(operand), i64Ty, "zxt", I);
         }
@@ -695,6 +779,8 @@ bool FlipIt::DynamicFaults::injectInOperand(Instruction* I, int operand)
     if (corruptVal == NULL) {
         corruptVal = call;
     }
+    if (rangeCheck && call != NULL)
+        rangeCalls.push_back(std::make_pair(call, rangeAddr));
     if (corruptVal) {
         I->setOperand(operand, corruptVal);
         comment = operand + 1;
@@ -704,6 +790,481 @@ bool FlipIt::DynamicFaults::injectInOperand(Instruction* I, int operand)
     return false;
 }
 
+/* site, byte position, and width arguments of the specialized corrupt function. A fixed
+   byte beyond the width of the value wraps around as it always has */
+void FlipIt::DynamicFaults::setCorruptArgs(Type* type)
+{
+    Type* i32Ty = IntegerType::getInt32Ty(getGlobalContext());
+    unsigned width = 8;
+    unsigned pos = 0;
+    if (type->isSized() && !type->isPointerTy())
+        width = Layout->getTypeStoreSize(type);
+    if (width == 0 || width > 8)
+        width = 8;
+
+    if (corruptSuffix == "_fixed")
+        pos = (byte_val % width)*8 + bit_val;
+    else if (corruptSuffix == "_fixedByte")
+        pos = byte_val % width;
+    else if (corruptSuffix == "_fixedBit")
+        pos = bit_val;
+
+    args[0] = ConstantInt::get(i64Ty, faultIdx);
+    args[3] = ConstantInt::get(i32Ty, pos);
+    args[4] = ConstantInt::get(i32Ty, width);
+}
+
+/****************************************************************************************/
+/* Inline mask instrumentation (-inlineMask)                                            */
+/*                                                                                      */
+/* Instead of a call at every site, each instrumented function asks the runtime once on */
+/* entry whether one of its sites is to be corrupted during this invocation. The armed  */
+/* site is kept in a stack slot that the sites compare with their own index: the armed  */
+/* site XORs its mask once and clears the slot, so it is corrupted a single time like a */
+/* call site. A site only adds a compare and two selects, no branch or call, so later   */
+/* optimizations can still hoist and unroll the loops around it.                        */
+/****************************************************************************************/
+/* how each site turns FLIPIT_InlineBits into a position (FLIPIT_INLINE_* in corrupt.h) */
+#define INLINE_RANDOM     0
+#define INLINE_FIXED      1
+#define INLINE_FIXED_BYTE 2
+#define INLINE_FIXED_BIT  3
+#define INLINE_LAYOUT(mode, width, pos) ((mode) << 16 | (width) << 8 | (pos))
+
+void FlipIt::DynamicFaults::armInline(Function* F, Instruction* InsertBefore)
+{
+    LLVMContext& C = getGlobalContext();
+    Type* i32Ty = Type::getInt32Ty(C);
+    Value* prob = instProbs["default"];
+    std::string cstr = demangle(F->getName().str());
+    if (funcProbs.find(cstr) != funcProbs.end())
+        prob = funcProbs[cstr];
+
+    std::vector<Type*> armParams;
+    armParams.push_back(i64Ty);
+    armParams.push_back(i32Ty);
+    armParams.push_back(Type::getDoubleTy(C));
+    armParams.push_back(i32Ty->getPointerTo());
+    func_inlineArm = declareRuntime("flipit_inlineArm",
+                                    FunctionType::get(i64Ty, armParams, false));
+    inlineBitsGlobal = M->getOrInsertGlobal("FLIPIT_InlineBits", i64Ty);
+
+    /* the number of sites and their layout are filled in by finishInline */
+    IRBuilder<> B(InsertBefore);
+    std::vector<Value*> armArgs;
+    armArgs.push_back(ConstantInt::get(i64Ty, faultIdx));
+    armArgs.push_back(ConstantInt::get(i32Ty, 0));
+    armArgs.push_back(prob);
+    armArgs.push_back(ConstantPointerNull::get(i32Ty->getPointerTo()));
+    inlineFirstSite = faultIdx;
+    inlineLayout.clear();
+    inlineArmed = B.CreateAlloca(i64Ty, 0, "flipit_armed");
+    inlineArmCall = B.CreateCall(func_inlineArm, armArgs, "flipit_site");
+    inlineArmStore = B.CreateStore(inlineArmCall, inlineArmed);
+    inlineBits = B.CreateLoad(inlineBitsGlobal, "flipit_bits");
+}
+
+void FlipIt::DynamicFaults::finishInline(unsigned int numSites)
+{
+    if (numSites == 0) {
+        cast<Instruction>(inlineBits)->eraseFromParent();
+        inlineArmStore->eraseFromParent();
+        inlineArmCall->eraseFromParent();
+        inlineArmed->eraseFromParent();
+        return;
+    }
+    Type* i32Ty = Type::getInt32Ty(getGlobalContext());
+    inlineArmCall->setArgOperand(1, ConstantInt::get(i32Ty, numSites));
+
+    /* one INLINE_LAYOUT word per site so the runtime logs the bit the site flips */
+    inlineLayout.resize(numSites, 0);
+    Constant* init = ConstantDataArray::get(getGlobalContext(), inlineLayout);
+    GlobalVariable* layout = new GlobalVariable(*M, init->getType(), true,
+                                                GlobalValue::PrivateLinkage, init,
+                                                "flipit_inlineLayout");
+    inlineArmCall->setArgOperand(3, ConstantExpr::getPointerCast(layout,
+                                                                 i32Ty->getPointerTo()));
+}
+
+/* V ^ (site armed ? 1 << position : 0), disarming the site the first time it hits */
+Value* FlipIt::DynamicFaults::inlineCorrupt(Value* V, Instruction* InsertBefore)
+{
+    IRBuilder<> B(InsertBefore);
+    Type* type = V->getType();
+    uint64_t width = cast<ConstantInt>(args[4])->getZExtValue();
+    Value* pos = args[3];
+    Value* bits = inlineBits;
+
+    unsigned int mode = INLINE_RANDOM;
+    if (corruptSuffix == "_fixed")
+        mode = INLINE_FIXED;
+    else if (corruptSuffix == "_fixedByte")
+        mode = INLINE_FIXED_BYTE;
+    else if (corruptSuffix == "_fixedBit")
+        mode = INLINE_FIXED_BIT;
+    uint64_t offset = faultIdx - inlineFirstSite;
+    if (offset >= inlineLayout.size())
+        inlineLayout.resize(offset + 1, 0);
+    inlineLayout[offset] = INLINE_LAYOUT(mode, width, cast<ConstantInt>(pos)->getZExtValue());
+
+    pos = B.CreateZExt(pos, i64Ty);
+    if (corruptSuffix == "_random")
+        pos = B.CreateURem(bits, ConstantInt::get(i64Ty, width*8));
+    else if (corruptSuffix == "_fixedByte")
+        pos = B.CreateAdd(B.CreateShl(pos, 3), B.CreateAnd(bits, 7));
+    else if (corruptSuffix == "_fixedBit")
+        pos = B.CreateAdd(B.CreateShl(B.CreateURem(bits, ConstantInt::get(i64Ty, width)), 3),
+                          pos);
+
+    Value* armed = B.CreateLoad(inlineArmed);
+    Value* hit = B.CreateICmpEQ(armed, args[0]);
+    B.CreateStore(B.CreateSelect(hit, Constant::getAllOnesValue(i64Ty), armed), inlineArmed);
+    Value* mask = B.CreateSelect(hit, B.CreateShl(ConstantInt::get(i64Ty, 1), pos),
+                                 ConstantInt::get(i64Ty, 0), "flipit_mask");
+
+    if (type->isIntegerTy())
+        return B.CreateXor(V, B.CreateTrunc(mask, type), "flipit_xor");
+    if (type->isPointerTy())
+        return B.CreateIntToPtr(B.CreateXor(B.CreatePtrToInt(V, i64Ty), mask), type,
+                                "flipit_xor");
+    Type* intTy = IntegerType::get(getGlobalContext(), width*8);
+    return B.CreateBitCast(B.CreateXor(B.CreateBitCast(V, intTy), B.CreateTrunc(mask, intTy)),
+                           type, "flipit_xor");
+}
+
+/****************************************************************************************/
+/* Armed guard (-armedGuard)                                                            */
+/*                                                                                      */
+/* The shared runtimes share one ABI: the full runtime injects, the profiling runtime   */
+/* only counts site executions, and the null runtime does nothing and leaves its        */
+/* FLIPIT_Armed flag at zero. Every runtime call of an instrumented function is wrapped */
+/* in a branch on that flag, and when it is clear the site's value passes through       */
+/* untouched, so golden runs with the null runtime cost a load and a branch per site.   */
+/****************************************************************************************/
+void FlipIt::DynamicFaults::guardArmed(Function* F)
+{
+    LLVMContext& C = getGlobalContext();
+    Type* i32Ty = Type::getInt32Ty(C);
+    armedGlobal = M->getOrInsertGlobal("FLIPIT_Armed", i32Ty);
+
+    std::vector<CallInst*> calls;
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        CallInst* call = dyn_cast<CallInst>(&*I);
+        if (call != NULL && (isCorruptFunction(call->getCalledValue())
+                             || (inlineMask && call->getCalledValue() == func_inlineArm)))
+            calls.push_back(call);
+    }
+
+    for (auto call : calls) {
+        /* unarmed, a corrupt call returns its value and flipit_inlineArm arms no site */
+        Value* unarmed = call->getCalledValue() == func_inlineArm
+            ? Constant::getAllOnesValue(i64Ty) : call->getArgOperand(2);
+        IRBuilder<> B(call);
+        Value* armed = B.CreateICmpNE(B.CreateLoad(armedGlobal, "flipit_armed"),
+                                      ConstantInt::get(i32Ty, 0));
+        guardCall(call, armed, unarmed);
+    }
+}
+
+/* the call only runs if cond holds; otherwise its users see unguarded */
+void FlipIt::DynamicFaults::guardCall(CallInst* call, Value* cond, Value* unguarded)
+{
+    BasicBlock* head = call->getParent();
+    TerminatorInst* T = SplitBlockAndInsertIfThen(cond, call, false);
+    BasicBlock* tail = call->getParent();
+    call->moveBefore(T);
+
+    PHINode* phi = PHINode::Create(call->getType(), 2, "flipit_guarded", tail->begin());
+    call->replaceAllUsesWith(phi);
+    phi->addIncoming(call, T->getParent());
+    phi->addIncoming(unguarded, head);
+}
+
+/****************************************************************************************/
+/* Range check (-rangeCheck)                                                            */
+/*                                                                                      */
+/* Only loads and stores are sites, and each calls into the runtime only if its address */
+/* is in one of the two intervals of FLIPIT_RangeInline (range.c): two subtractions and */
+/* unsigned compares, so other memory traffic pays no call. With more than two ranges   */
+/* the intervals are their hull, and the runtime finds the address in FLIPIT_RangeAddr  */
+/* to search the sorted ranges before it injects.                                       */
+/****************************************************************************************/
+void FlipIt::DynamicFaults::guardRanges(Function* F)
+{
+    rangeInlineGlobal = M->getOrInsertGlobal("FLIPIT_RangeInline", ArrayType::get(i64Ty, 4));
+    rangeAddrGlobal = cast<GlobalVariable>(M->getOrInsertGlobal("FLIPIT_RangeAddr", i64Ty));
+    rangeAddrGlobal->setThreadLocal(true);
+
+    for (auto rangeCall : rangeCalls) {
+        CallInst* call = rangeCall.first;
+        IRBuilder<> B(call);
+        Value* addr = B.CreatePtrToInt(rangeCall.second, i64Ty, "flipit_addr");
+        Value* hit = NULL;
+        for (unsigned i = 0; i < 2; i++) {
+            Value* base = B.CreateLoad(B.CreateConstInBoundsGEP2_64(rangeInlineGlobal, 0, 2*i));
+            Value* len = B.CreateLoad(B.CreateConstInBoundsGEP2_64(rangeInlineGlobal, 0, 2*i + 1));
+            Value* in = B.CreateICmpULT(B.CreateSub(addr, base), len);
+            hit = hit == NULL ? in : B.CreateOr(hit, in, "flipit_inRange");
+        }
+        guardCall(call, hit, call->getArgOperand(2));
+
+        /* the address is only valid for the duration of the call */
+        BasicBlock::iterator next(call);
+        next++;
+        new StoreInst(addr, rangeAddrGlobal, call);
+        new StoreInst(ConstantInt::get(i64Ty, 0), rangeAddrGlobal, next);
+    }
+    rangeCalls.clear();
+}
+
+/****************************************************************************************/
+/* Sites whose corrupted value reaches the rest of the program the same way are grouped */
+/* into one class. A value used only once, by an instruction in the same block or in a  */
+/* block that the definition dominates and that post-dominates it within the same loop, */
+/* carries any corruption straight into that use: e.g. a load feeding one fmul feeding  */
+/* one store, or a compare feeding its loop branch. Dominance alone does not mean the   */
+/* use runs as often as the definition; a definition before a loop and a use inside it  */
+/* are kept apart. PHIs merge paths and end a chain. Computed on the original function  */
+/* before it is instrumented.                                                           */
+/****************************************************************************************/
+void FlipIt::DynamicFaults::buildSiteClasses(Function* F)
+{
+    classParent.clear();
+    funcSites.clear();
+
+    DominatorTree DT;
+    DT.recalculate(*F);
+    DominatorTreeBase<BasicBlock> PDT(true);
+    PDT.recalculate(*F);
+#if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 6
+    LoopInfoBase<BasicBlock, Loop> LI;
+    LI.Analyze(DT);
+#else
+    LoopInfo LI;
+    LI.analyze(DT);
+#endif
+
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        Instruction* def = &*I;
+        if (!def->hasOneUse())
+            continue;
+        Instruction* use = dyn_cast<Instruction>(*def->user_begin());
+        if (use == NULL || isa<PHINode>(use))
+            continue;
+
+        BasicBlock* defBB = def->getParent();
+        BasicBlock* useBB = use->getParent();
+        if (defBB != useBB
+            && !(DT.dominates(defBB, useBB) && PDT.dominates(useBB, defBB)
+                 && LI.getLoopFor(defBB) == LI.getLoopFor(useBB)))
+            continue;
+
+        Instruction* a = siteClass(def);
+        Instruction* b = siteClass(use);
+        if (a != b)
+            classParent[a] = b;
+    }
+}
+
+Instruction* FlipIt::DynamicFaults::siteClass(Instruction* I)
+{
+    std::map<Instruction*, Instruction*>::iterator it = classParent.find(I);
+    if (it == classParent.end() || it->second == I)
+        return I;
+    Instruction* root = siteClass(it->second);
+    it->second = root;
+    return root;
+}
+
+/* the first site of a class is its representative */
+unsigned FlipIt::DynamicFaults::logSiteClasses()
+{
+    if (funcSites.empty())
+        return 0;
+
+    std::map<Instruction*, uint64_t> rep;
+    std::map<Instruction*, uint32_t> size;
+    for (unsigned i = 0; i < funcSites.size(); i++) {
+        Instruction* root = siteClass(funcSites[i].first);
+        if (rep.find(root) == rep.end())
+            rep[root] = funcSites[i].second;
+        size[root]++;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t> > classes;
+    for (unsigned i = 0; i < funcSites.size(); i++) {
+        Instruction* root = siteClass(funcSites[i].first);
+        classes.push_back(std::make_pair((uint32_t) (funcSites[i].second - rep[root]),
+                                         size[root]));
+        if (siteTable)
+            siteTable->logClass(funcSites[i].second, classes.back().first);
+    }
+    logfile->logClasses(classes);
+    funcSites.clear();
+    return rep.size();
+}
+
+/****************************************************************************************/
+/* Static site weights                                                                  */
+/*                                                                                      */
+/* How often every block executes per invocation of its function, from the static      */
+/* branch probabilities (BlockFrequencyInfo) with every loop whose trip count           */
+/* ScalarEvolution knows scaled to it. Written to the site log for every site, so a     */
+/* campaign can weight sites without a profiling run (profile = "static").              */
+/****************************************************************************************/
+#ifdef COMPILE_PASS
+void FlipIt::DynamicFaults::getAnalysisUsage(AnalysisUsage& AU) const
+{
+#if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 7
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.addRequired<BranchProbabilityInfo>();
+    AU.addRequired<ScalarEvolution>();
+#else
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<BranchProbabilityInfoWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+#endif
+#if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 6
+    AU.addRequired<LoopInfo>();
+#else
+    AU.addRequired<LoopInfoWrapperPass>();
+#endif
+}
+#endif
+
+void FlipIt::DynamicFaults::buildSiteWeights(Function* F)
+{
+    blockWeights.clear();
+    funcWeights.clear();
+#ifdef COMPILE_PASS
+    /* every getAnalysis() reruns all of them on F, so they are fetched before any is used */
+#if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 7
+    BlockFrequencyInfo& BFI = getAnalysis<BlockFrequencyInfo>(*F);
+    BranchProbabilityInfo& BPI = getAnalysis<BranchProbabilityInfo>(*F);
+    ScalarEvolution& SE = getAnalysis<ScalarEvolution>(*F);
+#else
+    BlockFrequencyInfo& BFI = getAnalysis<BlockFrequencyInfoWrapperPass>(*F).getBFI();
+    BranchProbabilityInfo& BPI = getAnalysis<BranchProbabilityInfoWrapperPass>(*F).getBPI();
+    ScalarEvolution& SE = getAnalysis<ScalarEvolutionWrapperPass>(*F).getSE();
+#endif
+#if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 6
+    LoopInfo& LI = getAnalysis<LoopInfo>(*F);
+#else
+    LoopInfo& LI = getAnalysis<LoopInfoWrapperPass>(*F).getLoopInfo();
+#endif
+
+    double entry = BFI.getBlockFreq(&F->getEntryBlock()).getFrequency();
+    if (entry == 0.)
+        return;
+    for (auto BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+        blockWeights[&*BB] = BFI.getBlockFreq(&*BB).getFrequency() / entry;
+
+    /* a known trip count replaces the iterations the branch probabilities imply */
+    std::vector<std::pair<Loop*, double> > scales;
+    std::vector<Loop*> loops(LI.begin(), LI.end());
+    while (!loops.empty()) {
+        Loop* L = loops.back();
+        loops.pop_back();
+        loops.insert(loops.end(), L->begin(), L->end());
+
+        const SCEVConstant* taken = dyn_cast<SCEVConstant>(SE.getBackedgeTakenCount(L));
+        if (taken == NULL)
+            continue;
+        BasicBlock* header = L->getHeader();
+        double entered = 0.;
+        for (pred_iterator P = pred_begin(header), PE = pred_end(header); P != PE; ++P) {
+            if (L->contains(*P))
+                continue;
+            BranchProbability prob = BPI.getEdgeProbability(*P, header);
+            entered += (double) BFI.getBlockFreq(*P).getFrequency()
+                * prob.getNumerator() / prob.getDenominator();
+        }
+        double iterations = BFI.getBlockFreq(header).getFrequency();
+        if (entered > 0. && iterations > 0.)
+            scales.push_back(std::make_pair(L,
+                (taken->getValue()->getValue().getLimitedValue() + 1.) * entered / iterations));
+    }
+    /* nested loops are scaled by their own and every enclosing loop's factor */
+    for (auto scale : scales)
+        for (auto BB = scale.first->block_begin(), BE = scale.first->block_end(); BB != BE; ++BB)
+            blockWeights[*BB] *= scale.second;
+#endif
+}
+
+void FlipIt::DynamicFaults::logSiteWeights()
+{
+    if (!funcWeights.empty())
+        logfile->logWeights(funcWeights);
+    funcWeights.clear();
+}
+
+/****************************************************************************************/
+/* Site table                                                                           */
+/*                                                                                      */
+/* The sites of the module go into the object file as a constant in the flipit_sites    */
+/* section. The linker concatenates the tables of all modules and defines               */
+/* __start_flipit_sites and __stop_flipit_sites around them, where FLIPIT_Init reads    */
+/* the number of sites without opening the state file.                                  */
+/****************************************************************************************/
+void FlipIt::DynamicFaults::emitSiteTable()
+{
+    LLVMContext& C = getGlobalContext();
+    Constant* data = ConstantDataArray::getString(C, siteTable->bytes(), false);
+    GlobalVariable* table = new GlobalVariable(*M, data->getType(), true,
+                                               GlobalValue::PrivateLinkage, data,
+                                               "flipit_siteTable");
+    table->setSection("flipit_sites");
+    table->setAlignment(8);
+
+    /* nothing refers to the table, so it goes into llvm.used to outlive global DCE */
+    Type* i8PtrTy = Type::getInt8PtrTy(C);
+    std::vector<Constant*> used;
+    if (GlobalVariable* old = M->getGlobalVariable("llvm.used")) {
+        if (ConstantArray* init = dyn_cast<ConstantArray>(old->getInitializer()))
+            for (unsigned i = 0; i < init->getNumOperands(); i++)
+                used.push_back(init->getOperand(i));
+        old->eraseFromParent();
+    }
+    used.push_back(ConstantExpr::getBitCast(table, i8PtrTy));
+    ArrayType* usedTy = ArrayType::get(i8PtrTy, used.size());
+    GlobalVariable* usedVar = new GlobalVariable(*M, usedTy, false,
+                                                 GlobalValue::AppendingLinkage,
+                                                 ConstantArray::get(usedTy, used), "llvm.used");
+    usedVar->setSection("llvm.metadata");
+}
+
+/****************************************************************************************/
+/* Site census (-census)                                                                */
+/*                                                                                      */
+/* The same site selection as an instrumented build, but the inject functions only say  */
+/* whether they would have corrupted the value. The site log comes out as it would from */
+/* the instrumented build, and every function gets a row of site counts.                */
+/****************************************************************************************/
+bool FlipIt::DynamicFaults::censusSite(Type* type, int siteComment)
+{
+    if (!(type->isIntegerTy() || type->isFloatTy() || type->isDoubleTy()
+          || type->isPointerTy()))
+        return false;
+    if (inlineMask && type->getPrimitiveSizeInBits() > 64)
+        return false;
+    comment = siteComment;
+    return true;
+}
+
+void FlipIt::DynamicFaults::censusFunction(std::string name, unsigned numSites,
+                                           unsigned numClasses)
+{
+    censusFile << name << "," << faultIdx - numSites << "," << numSites << "," << numClasses;
+    for (int i = ARITHMETIC_FP; i <= UNKNOWN_INJ; i++)
+        censusFile << "," << censusTypes[i];
+    censusFile << "\n";
+
+    for (auto elm : censusScratch) {
+        elm->dropAllReferences();
+        delete elm;
+    }
+    censusScratch.clear();
+}
 
 int FlipIt::DynamicFaults::selectArgument(CallInst* callInst) {
     int arg = -1;
@@ -783,31 +1344,384 @@ bool FlipIt::DynamicFaults::copyMetadata(Instruction* to, Instruction* from)
 }
 
 
-unsigned long FlipIt::DynamicFaults::cacheFunctions() { //Module::FunctionListType &functionList) {
+/* number of instructions in the functions that will be instrumented */
+unsigned long FlipIt::DynamicFaults::countInstructions() {
     unsigned long sum = 0; // # insts in module
     for (auto F = M->getFunctionList().begin(), E = M->getFunctionList().end(); F != E; F++) {
         string cstr = F->getName().str();
-        if (cstr.find("corruptIntData_64bit") != std::string::npos) {
-            func_corruptIntData_64bit =&*F;
-        } else if (cstr.find("corruptPtr2Int_64bit") != std::string::npos) {
-            func_corruptPtr2Int_64bit =&*F;
-        } else if (cstr.find("corruptFloatData_32bit") != std::string::npos) {
-            func_corruptFloatData_32bit =&*F;
-        } else if (cstr.find("corruptFloatData_64bit") != std::string::npos) {
-            func_corruptFloatData_64bit =&*F;
-        }
         /* TODO: check for function viability */
         if (F->begin() != F->end() && viableFunction(cstr, flist))
             for (auto BB = F->begin(), BBe = F->end(); BB != BBe; BB++) 
                 sum += BB->size();
     }/*end for*/
-
-    assert(func_corruptIntData_64bit != NULL && func_corruptPtr2Int_64bit != NULL
-        && func_corruptFloatData_32bit != NULL && func_corruptFloatData_64bit != NULL);
-    
     return sum;
 }
 
+/* every function of the runtime is a plain C function that does not unwind */
+Constant* FlipIt::DynamicFaults::declareRuntime(std::string name, FunctionType* type)
+{
+    Constant* C = M->getOrInsertFunction(name, type);
+    if (Function* F = dyn_cast<Function>(C)) {
+        F->setCallingConv(CallingConv::C);
+        F->addFnAttr(Attribute::NoUnwind);
+    }
+    return C;
+}
+
+/* T corrupt<T>_<suffix>(uint64_t site, double prob, T value, uint32_t pos, uint32_t width) */
+void FlipIt::DynamicFaults::declareCorruptFunctions()
+{
+    LLVMContext& C = getGlobalContext();
+    Type* i32Ty = Type::getInt32Ty(C);
+    Type* floatTy = Type::getFloatTy(C);
+    Type* doubleTy = Type::getDoubleTy(C);
+    Type* types[] = {i64Ty, i64Ty, floatTy, doubleTy};
+    const char* names[] = {"corruptIntData_64bit", "corruptPtr2Int_64bit",
+                           "corruptFloatData_32bit", "corruptFloatData_64bit"};
+    Value** funcs[] = {&func_corruptIntData_64bit, &func_corruptPtr2Int_64bit,
+                       &func_corruptFloatData_32bit, &func_corruptFloatData_64bit};
+
+    for (unsigned i = 0; i < 4; i++) {
+        std::vector<Type*> params;
+        params.push_back(i64Ty);
+        params.push_back(doubleTy);
+        params.push_back(types[i]);
+        params.push_back(i32Ty);
+        params.push_back(i32Ty);
+        *funcs[i] = declareRuntime(names[i] + corruptSuffix,
+                                   FunctionType::get(types[i], params, false));
+    }
+}
+
+/****************************************************************************************/
+/* Corruption propagation tracking (-taint)                                             */
+/*                                                                                      */
+/* Every instrumented function gets a clone that carries an i1 shadow for each value    */
+/* and keeps a shadow bit per byte of memory in the runtime (taint.c). The original     */
+/* function only pays a load and a branch at entry to dispatch to the clone once an     */
+/* injection has fired, and a compare of a corrupt call's result with its input in      */
+/* registers where that result is stored, so the golden prefix runs at normal           */
+/* instrumented speed.                                                                  */
+/****************************************************************************************/
+#define TAINT_MAX_ARGS 8
+
+void FlipIt::DynamicFaults::cloneForTaint()
+{
+    cacheTaintFunctions();
+
+    /* clone after instrumenting so the clones keep the same fault sites */
+    for (auto F : instrumented) {
+        if (F->isVarArg())
+            continue;
+        ValueToValueMapTy VMap;
+        Function* clone = CloneFunction(F, VMap, false);
+        clone->setName(F->getName() + ".flipit_taint");
+        clone->setLinkage(GlobalValue::InternalLinkage);
+        M->getFunctionList().push_back(clone);
+        taintClones[F] = clone;
+    }
+
+    for (auto FC : taintClones) {
+        instrumentTaint(FC.second);
+        seedTaintStores(FC.first);
+        dispatchToTaint(FC.first, FC.second);
+    }
+}
+
+void FlipIt::DynamicFaults::cacheTaintFunctions()
+{
+    LLVMContext& C = getGlobalContext();
+    Type* voidTy = Type::getVoidTy(C);
+    Type* i8Ty = Type::getInt8Ty(C);
+    Type* i32Ty = Type::getInt32Ty(C);
+    Type* i8PtrTy = Type::getInt8PtrTy(C);
+
+    func_taintLoad = M->getOrInsertFunction("flipit_taintLoad", i8Ty, i8PtrTy, i64Ty, NULL);
+    func_taintStore = M->getOrInsertFunction("flipit_taintStore", voidTy, i8PtrTy, i64Ty, i8Ty,
+                                             NULL);
+    func_taintCopy = M->getOrInsertFunction("flipit_taintCopy", voidTy, i8PtrTy, i8PtrTy, i64Ty,
+                                            NULL);
+    func_taintSeedStore = M->getOrInsertFunction("flipit_taintSeedStore", voidTy, i8PtrTy,
+                                                 i64Ty, NULL);
+    func_taintSite = M->getOrInsertFunction("flipit_taintSite", voidTy, i64Ty, i8Ty, NULL);
+    func_taintUntracked = M->getOrInsertFunction("flipit_taintUntracked", voidTy, i64Ty, NULL);
+
+    taintActive = M->getOrInsertGlobal("FLIPIT_TaintActive", i32Ty);
+    taintArgs = M->getOrInsertGlobal("FLIPIT_TaintArgs", ArrayType::get(i8Ty, TAINT_MAX_ARGS));
+    taintRet = M->getOrInsertGlobal("FLIPIT_TaintRet", i8Ty);
+}
+
+bool FlipIt::DynamicFaults::isCorruptFunction(Value* V)
+{
+    return V != NULL && (V == func_corruptIntData_64bit || V == func_corruptPtr2Int_64bit
+                         || V == func_corruptFloatData_32bit || V == func_corruptFloatData_64bit);
+}
+
+/* a corrupt call injected iff its result differs from its input; the bits are compared so a
+   NaN does not count as corrupted */
+Value* FlipIt::DynamicFaults::corrupted(IRBuilder<>& B, CallInst* CI, Value* result)
+{
+    Value* in = CI->getArgOperand(2);
+    if (!in->getType()->isIntegerTy()) {
+        Type* bitsTy = IntegerType::get(getGlobalContext(),
+                                        in->getType()->getPrimitiveSizeInBits());
+        in = B.CreateBitCast(in, bitsTy);
+        result = B.CreateBitCast(result, bitsTy);
+    }
+    return B.CreateICmpNE(result, in);
+}
+
+Value* FlipIt::DynamicFaults::getShadow(Value* V)
+{
+    auto it = shadows.find(V);
+    if (it != shadows.end())
+        return it->second;
+    return ConstantInt::getFalse(getGlobalContext());
+}
+
+Value* FlipIt::DynamicFaults::orShadows(IRBuilder<>& B, User* U, unsigned first, unsigned last)
+{
+    Value* s = ConstantInt::getFalse(getGlobalContext());
+    for (unsigned i = first; i < last && i < U->getNumOperands(); i++)
+        s = B.CreateOr(s, getShadow(U->getOperand(i)));
+    return s;
+}
+
+void FlipIt::DynamicFaults::instrumentTaint(Function* F)
+{
+    LLVMContext& C = getGlobalContext();
+    Type* i8Ty = Type::getInt8Ty(C);
+    Type* i8PtrTy = Type::getInt8PtrTy(C);
+    Value* zero8 = ConstantInt::get(i8Ty, 0);
+    std::vector<Instruction*> insts;
+    std::vector<PHINode*> phiList;
+    std::vector<Value*> rtArgs;
+    shadows.clear();
+
+    /* visit definitions before uses; grab the list before we add anything */
+    ReversePostOrderTraversal<Function*> RPOT(F);
+    for (auto BB : RPOT)
+        for (auto I = BB->begin(), E = BB->end(); I != E; I++)
+            insts.push_back(&*I);
+
+    /* argument shadows are left behind by the caller and cleared once read, so a call from
+       untracked code never finds the shadows of an earlier call */
+    IRBuilder<> entry(F->getEntryBlock().getFirstInsertionPt());
+    unsigned a = 0;
+    for (auto A = F->arg_begin(), AE = F->arg_end(); A != AE && a < TAINT_MAX_ARGS; A++, a++) {
+        Value* s = entry.CreateLoad(entry.CreateConstGEP2_32(taintArgs, 0, a));
+        shadows[&*A] = entry.CreateICmpNE(s, zero8);
+    }
+    for (unsigned i = 0; i < a; i++)
+        entry.CreateStore(zero8, entry.CreateConstGEP2_32(taintArgs, 0, i));
+
+    for (auto I : insts) {
+        BasicBlock::iterator INext(I);
+        INext++;
+
+        if (PHINode* phi = dyn_cast<PHINode>(I)) {
+            shadows[phi] = PHINode::Create(Type::getInt1Ty(C), phi->getNumIncomingValues(),
+                                           "taint", phi);
+            phiList.push_back(phi);
+        } else if (LoadInst* LI = dyn_cast<LoadInst>(I)) {
+            IRBuilder<> B(INext);
+            uint64_t size = Layout->getTypeStoreSize(LI->getType());
+            rtArgs.clear();
+            rtArgs.push_back(B.CreatePointerCast(LI->getPointerOperand(), i8PtrTy));
+            rtArgs.push_back(ConstantInt::get(i64Ty, size));
+            Value* s = B.CreateICmpNE(B.CreateCall(func_taintLoad, rtArgs), zero8);
+            shadows[LI] = B.CreateOr(s, getShadow(LI->getPointerOperand()));
+        } else if (StoreInst* SI = dyn_cast<StoreInst>(I)) {
+            IRBuilder<> B(SI);
+            uint64_t size = Layout->getTypeStoreSize(SI->getValueOperand()->getType());
+            Value* s = B.CreateOr(getShadow(SI->getValueOperand()),
+                                  getShadow(SI->getPointerOperand()));
+            rtArgs.clear();
+            rtArgs.push_back(B.CreatePointerCast(SI->getPointerOperand(), i8PtrTy));
+            rtArgs.push_back(ConstantInt::get(i64Ty, size));
+            rtArgs.push_back(B.CreateZExt(s, i8Ty));
+            B.CreateCall(func_taintStore, rtArgs);
+        } else if (CallInst* CI = dyn_cast<CallInst>(I)) {
+            Value* callee = CI->getCalledValue();
+            if (isCorruptFunction(callee)) {
+                /* the value is tainted if its input was or if it was just corrupted */
+                IRBuilder<> B(INext);
+                Value* s = B.CreateOr(getShadow(CI->getArgOperand(2)), corrupted(B, CI, CI));
+                rtArgs.clear();
+                rtArgs.push_back(CI->getArgOperand(0));
+                rtArgs.push_back(B.CreateZExt(s, i8Ty));
+                B.CreateCall(func_taintSite, rtArgs);
+                shadows[CI] = s;
+            } else if (isa<DbgInfoIntrinsic>(CI)) {
+                continue;
+            } else if (MemTransferInst* MT = dyn_cast<MemTransferInst>(CI)) {
+                IRBuilder<> B(CI);
+                rtArgs.clear();
+                rtArgs.push_back(B.CreatePointerCast(MT->getRawDest(), i8PtrTy));
+                rtArgs.push_back(B.CreatePointerCast(MT->getRawSource(), i8PtrTy));
+                rtArgs.push_back(B.CreateZExtOrTrunc(MT->getLength(), i64Ty));
+                B.CreateCall(func_taintCopy, rtArgs);
+            } else if (MemSetInst* MS = dyn_cast<MemSetInst>(CI)) {
+                IRBuilder<> B(CI);
+                rtArgs.clear();
+                rtArgs.push_back(B.CreatePointerCast(MS->getRawDest(), i8PtrTy));
+                rtArgs.push_back(B.CreateZExtOrTrunc(MS->getLength(), i64Ty));
+                rtArgs.push_back(B.CreateZExt(getShadow(MS->getValue()), i8Ty));
+                B.CreateCall(func_taintStore, rtArgs);
+            } else if (isa<IntrinsicInst>(CI)) {
+                IRBuilder<> B(INext);
+                if (!CI->getType()->isVoidTy())
+                    shadows[CI] = orShadows(B, CI, 0, CI->getNumArgOperands());
+            } else {
+                /* pass argument shadows through the runtime and collect the returned one */
+                IRBuilder<> B(CI);
+                for (unsigned i = 0; i < CI->getNumArgOperands() && i < TAINT_MAX_ARGS; i++)
+                    B.CreateStore(B.CreateZExt(getShadow(CI->getArgOperand(i)), i8Ty),
+                                  B.CreateConstGEP2_32(taintArgs, 0, i));
+                B.CreateStore(zero8, taintRet);
+
+                Function* Fn = CI->getCalledFunction();
+                bool tracked = Fn != NULL && taintClones.find(Fn) != taintClones.end();
+                if (tracked)
+                    CI->setCalledFunction(taintClones[Fn]);
+
+                /* a callee that is not a clone may not have read them */
+                B.SetInsertPoint(INext);
+                for (unsigned i = 0; !tracked && i < CI->getNumArgOperands()
+                                     && i < TAINT_MAX_ARGS; i++)
+                    B.CreateStore(zero8, B.CreateConstGEP2_32(taintArgs, 0, i));
+
+                if (!CI->getType()->isVoidTy()) {
+                    Value* s = B.CreateICmpNE(B.CreateLoad(taintRet), zero8);
+                    /* uninstrumented code does not report; assume the result depends on
+                       every argument */
+                    if (Fn == NULL || Fn->isDeclaration())
+                        s = B.CreateOr(s, orShadows(B, CI, 0, CI->getNumArgOperands()));
+                    shadows[CI] = s;
+                }
+            }
+        } else if (ReturnInst* RI = dyn_cast<ReturnInst>(I)) {
+            if (RI->getReturnValue() != NULL) {
+                IRBuilder<> B(RI);
+                B.CreateStore(B.CreateZExt(getShadow(RI->getReturnValue()), i8Ty), taintRet);
+            }
+        } else if (!I->getType()->isVoidTy() && !isa<TerminatorInst>(I)) {
+            /* everything else: the result is tainted if any operand is */
+            IRBuilder<> B(INext);
+            shadows[I] = orShadows(B, I, 0, I->getNumOperands());
+        }
+    }
+
+    for (auto phi : phiList) {
+        PHINode* s = cast<PHINode>(shadows[phi]);
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+            s->addIncoming(getShadow(phi->getIncomingValue(i)), phi->getIncomingBlock(i));
+    }
+}
+
+void FlipIt::DynamicFaults::seedTaintStores(Function* F)
+{
+    /* An injection that fires in the original function happens before the switch to the
+       clones, so the corrupted value is seeded in the shadow memory when it is stored. The
+       result of the corrupt call is compared with its input, without touching memory; it
+       may pass through the phi of -armedGuard or -rangeCheck and a cast. A corrupted value
+       that is also used in registers (arithmetic, compares, returns, calls) is lost until the
+       next instrumented call enters a clone, so those sites report that the propagation of
+       their injection is unknown */
+    std::vector<std::pair<StoreInst*, std::pair<CallInst*, Value*> > > stores;
+    std::vector<std::pair<Instruction*, std::pair<CallInst*, Value*> > > untracked;
+    for (auto I = inst_begin(F), E = inst_end(F); I != E; I++) {
+        CallInst* CI = dyn_cast<CallInst>(&*I);
+        if (CI == NULL || !isCorruptFunction(CI->getCalledValue()))
+            continue;
+
+        Value* result = CI;
+        if (CI->hasOneUse() && isa<PHINode>(*CI->user_begin()))
+            result = *CI->user_begin();
+        Value* corruptVal = result;
+        if (result->hasOneUse() && (isa<TruncInst>(*result->user_begin())
+                                    || isa<IntToPtrInst>(*result->user_begin())))
+            corruptVal = *result->user_begin();
+        bool seededOnly = true;
+        for (auto U : corruptVal->users()) {
+            StoreInst* SI = dyn_cast<StoreInst>(U);
+            if (SI != NULL && SI->getValueOperand() == corruptVal)
+                stores.push_back(std::make_pair(SI, std::make_pair(CI, result)));
+            else
+                seededOnly = false;
+        }
+        if (!seededOnly)
+            untracked.push_back(std::make_pair(cast<Instruction>(corruptVal),
+                                               std::make_pair(CI, result)));
+    }
+
+    LLVMContext& C = getGlobalContext();
+    Type* i8PtrTy = Type::getInt8PtrTy(C);
+    std::vector<Value*> rtArgs;
+    for (auto use : untracked) {
+        Instruction* INext = use.first;
+        if (isa<PHINode>(INext))
+            INext = &*INext->getParent()->getFirstInsertionPt();
+        else
+            INext = INext->getNextNode();
+        IRBuilder<> B(INext);
+        Value* lost = corrupted(B, use.second.first, use.second.second);
+        TerminatorInst* T = SplitBlockAndInsertIfThen(lost, INext, false);
+
+        B.SetInsertPoint(T);
+        rtArgs.clear();
+        rtArgs.push_back(use.second.first->getArgOperand(0));
+        B.CreateCall(func_taintUntracked, rtArgs);
+    }
+    for (auto store : stores) {
+        StoreInst* SI = store.first;
+        BasicBlock::iterator INext(SI);
+        INext++;
+        IRBuilder<> B(INext);
+        Value* seeded = corrupted(B, store.second.first, store.second.second);
+        TerminatorInst* T = SplitBlockAndInsertIfThen(seeded, &*INext, false);
+
+        B.SetInsertPoint(T);
+        rtArgs.clear();
+        rtArgs.push_back(B.CreatePointerCast(SI->getPointerOperand(), i8PtrTy));
+        rtArgs.push_back(ConstantInt::get(i64Ty,
+            Layout->getTypeStoreSize(SI->getValueOperand()->getType())));
+        B.CreateCall(func_taintSeedStore, rtArgs);
+    }
+}
+
+void FlipIt::DynamicFaults::dispatchToTaint(Function* F, Function* clone)
+{
+    LLVMContext& C = getGlobalContext();
+    BasicBlock* oldEntry = &F->getEntryBlock();
+    BasicBlock* dispatch = BasicBlock::Create(C, "flipit_dispatch", F, oldEntry);
+    BasicBlock* tracked = BasicBlock::Create(C, "flipit_tracked", F, oldEntry);
+
+    IRBuilder<> B(dispatch);
+    Value* active = B.CreateLoad(taintActive);
+    BranchInst* br = B.CreateCondBr(B.CreateICmpNE(active, ConstantInt::get(
+        Type::getInt32Ty(C), 0)), tracked, oldEntry);
+
+    /* keep static allocas in the entry block so they are still promoted to registers */
+    for (auto I = oldEntry->begin(), E = oldEntry->end(); I != E;) {
+        AllocaInst* AI = dyn_cast<AllocaInst>(&*I);
+        I++;
+        if (AI != NULL && isa<Constant>(AI->getArraySize()))
+            AI->moveBefore(br);
+    }
+
+    B.SetInsertPoint(tracked);
+    std::vector<Value*> fargs;
+    for (auto A = F->arg_begin(), AE = F->arg_end(); A != AE; A++)
+        fargs.push_back(&*A);
+    CallInst* call = B.CreateCall(clone, fargs);
+    call->setCallingConv(clone->getCallingConv());
+    if (F->getReturnType()->isVoidTy())
+        B.CreateRetVoid();
+    else
+        B.CreateRet(call);
+}
+
 bool FlipIt::DynamicFaults::corruptInstruction(Instruction* I) {
 #ifndef COMPILE_PASS
         std::vector<std::string> dummyVector;
@@ -823,11 +1737,6 @@ bool FlipIt::DynamicFaults::injectFault(Instruction* I) {
     bool inj = false;
     comment = 0; injectionType = 0;
     
-    unsigned int t_byte_val = (byte_val << 28) & 0xF0000000;
-    unsigned int t_bit_val = (bit_val << 24) & 0x0F000000;
-    unsigned int t_faultIdx = faultIdx & 0x00FFFFFF;
-    parameter = t_byte_val | t_bit_val | t_faultIdx;
-    
     if (ctrl_err && injectControl_NEW(I)) {
         inj = true;
     } else if (arith_err && injectArithmetic_NEW(I)) {
@@ -859,11 +1768,18 @@ bool FlipIt::DynamicFaults::injectFault(Instruction* I) {
     if (inj && !simdInst) {
         // Site #,   injection type, comment, inst
 
-        //errs() << "FIDX = " << faultIdx << "parameter Idx = " << (parameter & 0x00FFFFFF) << " \n";
 #ifndef COMPILE_PASS
         logfile->logFunctionHeader(faultIdx, I->getParent()->getParent()->getName().str());
-        faultIdx = updateStateFile(stateFile.c_str(), 1);
+        faultIdx = siteBase + updateStateFile(stateFile.c_str(), 1);
 
+#else
+        funcSites.push_back(std::make_pair(I, faultIdx));
+        std::map<BasicBlock*, double>::iterator w = blockWeights.find(I->getParent());
+        funcWeights.push_back(w == blockWeights.end() ? 1.f : (float) w->second);
+        if (siteTable)
+            siteTable->logInst(faultIdx, injectionType, comment, I, funcWeights.back());
+        if (census)
+            censusTypes[injectionType <= UNKNOWN_INJ ? injectionType : UNKNOWN_INJ]++;
 #endif
         logfile->logInst(faultIdx++, injectionType, comment, I);
     }
@@ -56,6 +56,17 @@
 #include <llvm/IR/DebugInfo.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/TypeBuilder.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/BranchProbabilityInfo.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
 
 
 //#include <DataLayout.h>
@@ -71,6 +82,12 @@ static cl::opt<bool> arith_err("arith", cl::desc("Inject Faults Into Arithmetic
 static cl::opt<bool> ctrl_err("ctrl", cl::desc("Inject Faults Into Control Instructions"), cl::value_desc("0/1"), cl::init(1), cl::ValueRequired);
 static cl::opt<bool> ptr_err("ptr", cl::desc("Inject Faults Into Pointer Instructions"), cl::value_desc("0/1"), cl::init(1), cl::ValueRequired);
 static cl::opt<string> srcFile("srcFile", cl::desc("Name of the source file being compiled"), cl::value_desc("e.g. foo.c, foo.cpp, or foo.f90"), cl::init("UNKNOWN"), cl::ValueRequired);
+static cl::opt<bool> taint("taint", cl::desc("Clone instrumented functions into versions that track the propagation of a corrupted value"), cl::value_desc("0/1"), cl::init(0), cl::ValueRequired);
+static cl::opt<bool> inlineMask("inlineMask", cl::desc("Corrupt with an inline XOR mask armed once per function invocation instead of a call at every site; the armed site is corrupted on its first execution in that invocation, and the probability counts invocations rather than site executions"), cl::value_desc("0/1"), cl::init(0), cl::ValueRequired);
+static cl::opt<unsigned> siteModule("siteModule", cl::desc("Module number placed in the upper 32 bits of every fault site index so separately instrumented libraries do not share indexes (4294967295 is reserved for MPI payload sites)"), cl::value_desc("0, 1, 2, ..."), cl::init(0), cl::ValueRequired);
+static cl::opt<bool> armedGuard("armedGuard", cl::desc("Skip every call into the runtime unless its FLIPIT_Armed flag is set, so a binary run with the null shared runtime costs a load and a branch per site"), cl::value_desc("0/1"), cl::init(0), cl::ValueRequired);
+static cl::opt<bool> rangeCheck("rangeCheck", cl::desc("Only inject into loads and stores, and only call into the runtime when the address is in a range registered with FLIPIT_RegisterRange"), cl::value_desc("0/1"), cl::init(0), cl::ValueRequired);
+static cl::opt<bool> census("census", cl::desc("Only find the fault sites: write the site log and <srcFile>.census.csv without changing the IR or the state file"), cl::value_desc("0/1"), cl::init(0), cl::ValueRequired);
 static cl::opt<string> stateFile("stateFile", cl::desc("Name of the state file being updated when compiled. Used to provide unique fault site indexes."), cl::value_desc("FlipItState"), cl::init("FlipItState"), cl::ValueRequired);
 #endif
 
@@ -94,6 +111,11 @@ namespace FlipIt {
             bool ptr_err;
             std::string srcFile;
             std::string stateFile;
+            bool taint;
+            bool inlineMask;
+            bool armedGuard;
+            bool rangeCheck;
+            bool census;
 #endif
         public:
             static char ID; 
@@ -113,6 +135,9 @@ namespace FlipIt {
             virtual ~DynamicFaults()
                 { finalize(); }
             virtual bool runOnModule(Module &M);
+#ifdef COMPILE_PASS
+            virtual void getAnalysisUsage(AnalysisUsage& AU) const;
+#endif
             bool corruptInstruction(Instruction* I);
 
 		private:
@@ -126,7 +151,8 @@ namespace FlipIt {
             Value* getInstProb(Instruction* I);
             std::string demangle(std::string name);
             bool viableFunction(std::string name, std::vector<std::string>& flist);
-            unsigned long updateStateFile(const char* stateFile, unsigned long sum);
+            unsigned long updateStateFile(const char* stateFile, unsigned long sum,
+                                          bool readOnly = false);
 
             bool injectControl(Instruction* I);
             bool injectArithmetic(Instruction* I);
@@ -140,6 +166,21 @@ namespace FlipIt {
             bool injectCall_NEW(Instruction* I);
             bool injectResult(Instruction* I);
 			bool injectInOperand(Instruction* I, int operand);
+            void setCorruptArgs(Type* type);
+            Value* inlineCorrupt(Value* V, Instruction* InsertBefore);
+            void armInline(Function* F, Instruction* InsertBefore);
+            void finishInline(unsigned int numSites);
+            void guardArmed(Function* F);
+            void guardRanges(Function* F);
+            void guardCall(CallInst* call, Value* cond, Value* unguarded);
+            void buildSiteClasses(Function* F);
+            Instruction* siteClass(Instruction* I);
+            unsigned logSiteClasses();
+            void buildSiteWeights(Function* F);
+            void logSiteWeights();
+            void emitSiteTable();
+            bool censusSite(Type* type, int siteComment);
+            void censusFunction(std::string name, unsigned numSites, unsigned numClasses);
             
             bool inject_Store_Data(Instruction* I,  CallInst* CallI);
             bool inject_Compare(Instruction* I, CallInst* CallI);
@@ -151,12 +192,25 @@ namespace FlipIt {
             bool inject_Call(Instruction* I, CallInst* CallI, BasicBlock* BB);
             bool inject_GetElementPtr_Ptr(Instruction* I, CallInst* CallI, BasicBlock* BB);
             
+            void cloneForTaint();
+            void cacheTaintFunctions();
+            void instrumentTaint(Function* F);
+            void seedTaintStores(Function* F);
+            void dispatchToTaint(Function* F, Function* clone);
+            Value* corrupted(IRBuilder<>& B, CallInst* CI, Value* result);
+            Value* getShadow(Value* V);
+            Value* orShadows(IRBuilder<>& B, User* U, unsigned first, unsigned last);
+            bool isCorruptFunction(Value* V);
+
             bool copyMetadata(Instruction* New, Instruction* Old);
-            unsigned long cacheFunctions();
+            unsigned long countInstructions();
+            void declareCorruptFunctions();
+            Constant* declareRuntime(std::string name, FunctionType* type);
             bool injectFault(Instruction* I);
 
             Module* M;
             LogFile* logfile;
+            SiteTable* siteTable;
             DataLayout* Layout;
  
             Value* func_corruptIntData_8bit;
@@ -172,6 +226,53 @@ namespace FlipIt {
             Value* func_corruptIntAdr_64bit;
             Value* func_corruptFloatAdr_32bit;
             Value* func_corruptFloatAdr_64bit;
+            std::string corruptSuffix; // _fixed, _fixedByte, _fixedBit, or _random
+
+            // corruption propagation tracking (-taint)
+            Constant* func_taintLoad;
+            Constant* func_taintStore;
+            Constant* func_taintCopy;
+            Constant* func_taintSeedStore;
+            Constant* func_taintSite;
+            Constant* func_taintUntracked;
+            Constant* taintActive;
+            Constant* taintArgs;
+            Constant* taintRet;
+            std::vector<Function*> instrumented;
+            std::map<Function*, Function*> taintClones;
+            std::map<Value*, Value*> shadows;
+
+            // inline mask instrumentation (-inlineMask)
+            Constant* func_inlineArm;
+            Constant* inlineBitsGlobal;
+            CallInst* inlineArmCall;
+            StoreInst* inlineArmStore;
+            AllocaInst* inlineArmed;
+            Value* inlineBits;
+            uint64_t inlineFirstSite;
+            std::vector<uint32_t> inlineLayout;
+
+            // runtime calls skipped unless the shared runtime is armed (-armedGuard)
+            Constant* armedGlobal;
+
+            // loads and stores outside of the registered address ranges (-rangeCheck)
+            Constant* rangeInlineGlobal;
+            GlobalVariable* rangeAddrGlobal;
+            Value* rangeAddr;
+            std::vector<std::pair<CallInst*, Value*> > rangeCalls;
+
+            // def-use equivalence classes of the sites in the current function
+            std::map<Instruction*, Instruction*> classParent;
+            std::vector<std::pair<Instruction*, uint64_t> > funcSites;
+
+            // static executions per invocation of the blocks and sites of the current function
+            std::map<BasicBlock*, double> blockWeights;
+            std::vector<float> funcWeights;
+
+            // site counts without instrumenting (-census)
+            std::ofstream censusFile;
+            unsigned censusTypes[UNKNOWN_INJ + 1];
+            std::vector<Instruction*> censusScratch;
 
             // used for display and analysis
             Type* i64Ty;
@@ -182,10 +283,10 @@ namespace FlipIt {
             int comment;
             int injectionType;
             std::stringstream strStream;
-            unsigned int oldFaultIdx;
-            unsigned int faultIdx;
+            uint64_t oldFaultIdx;
+            uint64_t faultIdx;
+            uint64_t siteBase;
             unsigned int displayIdx;
-            unsigned int parameter;
             std::vector<std::string> flist;
             std::vector <Instruction*> phis;
             bool simdInst;